@@ -47,6 +47,7 @@
  - 2) If you are having issue with black icons, try building project with Visual Studio (better) or uncommenting `/D ICONS_SET_BACKGROUND` in Makefile-nmake-64 (worse).
  - 3) If you want to test P6 without having wxWidgets, delete `-D P6_FILE_WXWIDGETS` from Makefile or Makefile-nmake-64 respectively.
  - 4) If you do not want to use `dot`, disable this option in Doxyfile by setting `HAVE_DOT = NO`.
+ - 5) If you want to know where simulation spends it's time, add `-D P6_SIMULATION_STATISTICS` to compile flags and read `Solution::get_statistics`.
 
 @section Help
  Application is developed to be simple, but there are some non-obvious moments:
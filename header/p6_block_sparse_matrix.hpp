@@ -0,0 +1,100 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+#ifndef P6_BLOCK_SPARSE_MATRIX
+#define P6_BLOCK_SPARSE_MATRIX
+
+#include "p6_common.hpp"
+#include <vector>
+
+namespace p6
+{
+	class Vector;
+	class Matrix;
+
+	///Square matrix stored as dense blocks in compressed rows (BSR), one block row and column per node
+	///Blocks are 2x2 for free nodes, 1x1 for nodes on rail and mixed between them. Pattern is symmetric
+	class BlockSparseMatrix
+	{
+	private:
+		//Blocks
+		std::vector<uint> _size;			///<Size of each block row and column
+		std::vector<uint> _start;			///<First scalar index of each block, one extra entry in the end
+		std::vector<uint> _block;			///<Block of each scalar index
+		std::vector<uint> _row;				///<First stored block of each block row, one extra entry in the end
+		std::vector<uint> _column;			///<Block column of each stored block, sorted within block row
+		std::vector<uint> _offset;			///<Offset of each stored block in values
+		std::vector<real> _value;			///<Values of stored blocks, each block is row-major
+
+		//Envelope LU factorization in reverse Cuthill-McKee order
+		std::vector<uint> _permutation;		///<Original scalar index of each reordered scalar index
+		std::vector<uint> _position;		///<Reordered scalar index of each original scalar index
+		std::vector<uint> _first;			///<First reordered index of row's (and column's) envelope
+		std::vector<uint> _envelope;		///<Offset of row of L (and column of U) in envelope arrays
+		std::vector<uint> _column_end;		///<One after last reordered row whose envelope includes column
+		std::vector<real> _lower;			///<Rows of unit lower triangular L within envelope
+		std::vector<real> _upper;			///<Columns of upper triangular U within envelope, without diagonal
+		std::vector<real> _diagonal;		///<Diagonal of U
+		std::vector<float> _lower_single;	///<Rows of L in single precision
+		std::vector<float> _upper_single;	///<Columns of U in single precision
+		std::vector<float> _diagonal_single;///<Diagonal of U in single precision
+		bool _factorized = false;			///<Indicator if factorization is valid
+		bool _single = false;				///<Indicator if factorization is in single precision
+		bool _symmetric = false;			///<Indicator if factorization is L * D * L^T, U is not stored
+		real _tolerance = 0.0;				///<Smallest acceptable pivot of symmetric factorization
+		std::vector<real> _factorized_value;///<Values of last successful factorization, factors of unchanged leading submatrix are reused
+		bool _reusable = false;				///<Indicator if factors correspond to factorized values
+		uint _factorization_start = 0;		///<First reordered index recomputed by last factorization
+
+		void _create_envelope() noexcept;	///<Orders blocks and creates envelope structure
+		uint _get_changed_start()			const noexcept;	///<Returns first reordered index whose leading submatrix changed since last factorization
+		template <class T> bool _factorize(uint start, std::vector<T> *lower, std::vector<T> *upper, std::vector<T> *diagonal) noexcept;	///<Factorizes matrix in given precision from given reordered index
+		bool _factorize_symmetric(real tolerance, std::vector<uint> *dependent) noexcept;	///<Factorizes as L * D * L^T with pivots above tolerance relative to largest entry, removes dependent variables if they are requested
+		template <class T> void _solve(const std::vector<T> *lower, const std::vector<T> *upper, const std::vector<T> *diagonal, const Vector *b, Vector *x) const noexcept;	///<Solves system in given precision
+
+	public:
+		///Creates zero matrix with given block sizes and pattern, pattern is list of block index pairs (-1 is ignored), diagonal is always stored
+		void create(const std::vector<uint> &size, const std::vector<uint> &pattern) noexcept;
+		void set_zero()											noexcept;	///<Sets all stored values to zero
+		real &at(uint row, uint column)							noexcept;	///<Returns stored value, it must be within pattern
+		uint find(uint row, uint column)						const noexcept;	///<Returns offset of stored value in values, it must be within pattern
+		real &value(uint offset)								noexcept;	///<Returns stored value by it's offset
+		real value(uint offset)									const noexcept;	///<Returns stored value by it's offset
+		void get_values(std::vector<real> *value)				const;		///<Returns all stored values
+		void set_values(const std::vector<real> *value)			noexcept;	///<Sets all stored values, they must be returned by get_values
+		uint get_size()											const noexcept;	///<Returns number of scalar rows (and columns)
+		uint get_block_count()									const noexcept;	///<Returns number of block rows (and columns)
+		uint get_stored_block_count()							const noexcept;	///<Returns number of stored blocks
+		uint get_block_size(uint block)							const noexcept;	///<Returns size of block row (and column)
+		void get_block_pattern(std::vector<uint> *pattern)		const;		///<Appends block index pairs of stored off-diagonal blocks, format is accepted by create
+		uint get_stored_value_count()							const noexcept;	///<Returns number of stored scalar values
+		uint get_envelope_size()								const noexcept;	///<Returns number of entries of L (and of U) within envelope
+		real get_factorization_cost()							const noexcept;	///<Returns estimated number of multiply-adds of factorization
+		void get_entries(std::vector<uint> *row, std::vector<uint> *column, std::vector<real> *value) const;	///<Appends all stored values and their scalar indexes
+		void multiply(const Vector *x, Vector *y)				const noexcept;	///<Returns product of matrix and vector
+		void to_dense(Matrix *dense)							const noexcept;	///<Returns matrix as dense
+		void equilibrate(Vector *row_scale, Vector *column_scale)	noexcept;	///<Scales rows and columns until their largest entries are close to one, returns applied scales
+		bool factorize(bool single = false)						noexcept;	///<Factorizes matrix without pivoting in double or single precision, returns false if pivot is too small
+		uint get_factorization_start()							const noexcept;	///<Returns first reordered index recomputed by last factorization, matrix size if nothing changed
+		bool factorize_symmetric()								noexcept;	///<Factorizes symmetric positive definite matrix as L * D * L^T, returns false if pivot is not positive
+		///Factorizes symmetric positive semidefinite matrix as L * D * L^T, variables with pivot below tolerance (relative to largest entry) are dependent
+		///Dependent variables are returned by their scalar indexes and removed from factorization, returns false if there are any
+		bool factorize_semidefinite(real tolerance, std::vector<uint> *dependent) noexcept;
+		///Adds sigma * w * w^T to matrix and updates symmetric factorization, w is given by indexes and values of it's non-zero entries
+		///Returns false if updated matrix is not positive definite, factorization is invalid then
+		bool update(const std::vector<uint> *index, const std::vector<real> *value, real sigma) noexcept;
+		void solve(const Vector *b, Vector *x)					const noexcept;	///<Solves system with factorized matrix
+		void solve(const Matrix *b, Matrix *x)					const noexcept;	///<Solves system for all columns of b at once, factorization must be in double precision
+		void solve_transposed(const Vector *b, Vector *x)		const noexcept;	///<Solves system with transposed factorized matrix, factorization must be in double precision
+		bool refine(const Vector *b, Vector *x)					const noexcept;	///<Solves system with iterative refinement against double precision residual, returns false if refinement stalls
+	};
+}
+
+#endif
@@ -12,16 +12,30 @@
 #define P6_CONSTRUCTION
 
 #include "p6_material.hpp"
+#include "p6_snapshot.hpp"
+#include "p6_solution.hpp"
 #include <vector>
+#include <memory>
+#include <iosfwd>
 
 namespace p6
 {
+	class InputFile;
+	class OutputFile;
+
 	///Truss construction
 	class Construction
 	{
+	public:
+		///Way of condensing superelement to it's boundary nodes
+		enum class Condensation
+		{
+			linear,		///<Condensed in initial position
+			tangent		///<Condensed in equilibrium under own forces, with boundary nodes fixed
+		};
+
 	private:
-		class Vector;	///<Mathematical vector
-		class Matrix;	///<Mathematical matrix
+		friend class Snapshot;
 
 		///File header
 		struct Header
@@ -33,20 +47,14 @@ namespace p6
 			uint material;
 		};
 
-		///Node data valid both during editing and simulation
-		struct StaticNode
+		///Node data
+		struct Node
 		{
 			unsigned char freedom;
 			real angle;
 			Coord coord;
 		};
 
-		///Node data valid during simulation only
-		struct Node : StaticNode
-		{
-			Coord coord_simulated;
-		};
-
 		///Stick data
 		struct Stick
 		{
@@ -62,74 +70,37 @@ namespace p6
 			Coord direction;
 		};
 
-		std::vector<Node> _node;			///<List of all nodes
-		std::vector<Stick> _stick;			///<List of all sticks
-		std::vector<Force> _force;			///<List of all forces
-		std::vector<Material*> _material;	///<List of all materials
-		bool _simulation = false;			///<Indicator if simulation is being run
-		uint _nfree2d;						///<Number of fully free nodes, set by _create_map
-		uint _nfree1d;						///<Number of free along rail nodes, set by _create_map
-
-		uint _node_equation_fx(uint free2d)					const noexcept;	///<Returns equation index of horizontal node force balance
-		uint _node_equation_fy(uint free2d)					const noexcept;	///<Returns equation index of vertical node force balance
-		uint _node_equation_fr(uint free1d)					const noexcept;	///<Returns equation index of node force balance along it's rail
-		uint _equation_number()								const noexcept;	///<Returns equation number
-		uint _node_variable_x(uint free2d)					const noexcept;	///<Returns variable index of node's X coordinate
-		uint _node_variable_y(uint free2d)					const noexcept;	///<Returns variable index of node's Y coordinate
-		uint _node_variable_r(uint free1d)					const noexcept;	///<Returns variable index of node's coordinate along it's rail
-		uint _variable_number()								const noexcept;	///<Returns variable number
-		void _check_materials_specified()					const;			///<Checks if materials of all sticks are specified
-		void _create_map(std::vector<uint> *node_to_free)	noexcept;		///<Creates node-to-free map
-		real _get_tolerance()								const noexcept;	///<Returns force tolerance
-		
-		///Creates state, should-be-zero, modification vectors and derivative matrix
-		void _create_vectors(
-			const std::vector <uint> *node_to_free,
-			Vector *s,
-			Vector *z,
-			Vector *m,
-			Matrix *d) const noexcept;
-		///Sets should-be-zero value to external forces
-		void _set_z_to_external_forces(
-			const std::vector <uint> *node_to_free,
-			Vector *z) const noexcept;
-		///Sets derivative of shoud-be-zero to zero
-		void _set_d_to_zero(
-			const std::vector <uint> *node_to_free,
-			Matrix *d) const noexcept;
-		///Gets coordinate difference between two nodes
-		Coord _get_delta(
-			uint stick,
-			const std::vector <uint> *node_to_free,
-			const Vector *s) const noexcept;
-		///Modifies should-be-zero value with force of some stick
-		void _modify_z_with_stick_force(
-			uint stick,
-			const std::vector <uint> *node_to_free,
-			const Vector *s,
-			Vector *z) const noexcept;
-		///Modifies derivative of should-be-zero with derivatives of force of some stick
-		void _modify_d_with_stick_force(
-			uint stick,
-			const std::vector <uint> *node_to_free,
-			const Vector *s,
-			Matrix *d) const noexcept;	
-		///Gets residuum
-		real _get_residuum(const Vector *z) const noexcept;
-		///Decides if Newton's modification is adequate
-		bool _is_adequate(
-			const Vector *m,
-			const std::vector <uint> *node_to_free,
-			const Vector *s) const noexcept;
-		///Gets flow coefficient
-		real _get_flow_coefficient(
-			const std::vector <uint> *node_to_free,
-			const Vector *s,
-			const Vector *z) const noexcept;
-		///Sets items' data correspondent to state vector
-		void _apply_state_vector(
-			const std::vector<uint> *node_to_free,
-			const Vector *s) noexcept;
+		///Sub-assembly condensed to it's boundary nodes, shared by all superelements imported from one file
+		struct Block
+		{
+			String filepath;				///<File the block was condensed from
+			Condensation condensation;		///<Way of condensing
+			std::vector<Coord> coord;		///<Initial coordinates of boundary nodes
+			std::vector<real> tangent;		///<Condensed derivative of should-be-zero value, row-major, two rows per boundary node
+			std::vector<real> force;		///<Condensed should-be-zero value in initial position, two per boundary node
+		};
+
+		///Superelement data
+		struct Superelement
+		{
+			std::vector<uint> node;					///<Boundary nodes
+			std::shared_ptr<const Block> block;		///<Condensed block
+		};
+
+		std::vector<Node> _node;							///<List of all nodes
+		std::vector<Stick> _stick;							///<List of all sticks
+		std::vector<Force> _force;							///<List of all forces
+		std::vector<Material*> _material;					///<List of all materials
+		std::vector<Superelement> _superelement;			///<List of all superelements
+		std::vector<std::shared_ptr<const Block>> _block;	///<Cache of condensed blocks
+		bool _simulation = false;							///<Indicator if simulation is being run
+		Solution _solution;									///<Result of simulation, valid during simulation only
+		Snapshot::Options _options;							///<Parameters of simulation
+		std::ostream *_log = nullptr;						///<Stream automatic choices of solver and simulation warnings are logged to, may be null
+
+		static std::shared_ptr<const Block> _condense(const String filepath, Condensation condensation);	///<Condenses saved construction to it's fixed nodes
+		void _write_superelements(OutputFile *file) const;	///<Writes blocks and superelements to file
+		void _read_superelements(InputFile *file, uint node_offset);	///<Reads blocks and superelements from file, appends them to existing
 
 	public:
 		//Node
@@ -174,11 +145,24 @@ namespace p6
 		real get_material_modulus(uint material)						const noexcept;	///<Returns linear material's Young's modulus
 		String get_material_formula(uint material)						const noexcept;	///<Returns non-linear material's stress-srain formula
 		
+		//Superelement
+		uint import_superelement(const String filepath, Condensation condensation);	///<Imports construction as superelement condensed to it's fixed nodes, returns it's index
+		void delete_superelement(uint superelement)						noexcept;		///<Deletes superelement, leaves it's boundary nodes
+		uint get_superelement_count()									const noexcept;	///<Returns superelement number
+		uint get_superelement_node_count(uint superelement)				const noexcept;	///<Returns number of superelement's boundary nodes
+		uint get_superelement_node(uint superelement, uint index)		const noexcept;	///<Returns superelement's boundary node
+
 		//Maintanance
 		void save(const String filepath) const;	///<Saves construction to file
 		void load(const String filepath);		///<Loads constuction from file
 		void import(const String filepath);		///<Imports consruction from file
 		void simulate(bool sim);				///<Runs or inverts simulation
+		void set_options(const Snapshot::Options *options)	noexcept;	///<Sets parameters of simulation
+		Snapshot::Options get_options()			const noexcept;	///<Returns parameters of simulation
+		void set_log(std::ostream *log)			noexcept;	///<Sets stream automatic choices of solver, their costs and simulation warnings are logged to, null disables logging
+		///Returns derivatives of response by area and modulus of every stick, simulation must be running
+		void get_sensitivity(const Snapshot::Response *response, std::vector<real> *area, std::vector<real> *modulus) const;
+		Snapshot snapshot() const;				///<Returns immutable copy of construction that can be simulated concurrently
 
 		~Construction();						///<Destroys construction
 	};
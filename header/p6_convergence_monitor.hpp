@@ -0,0 +1,73 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#ifndef P6_CONVERGENCE_MONITOR
+#define P6_CONVERGENCE_MONITOR
+
+#include "p6_common.hpp"
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+
+namespace p6
+{
+	///Watches residual history of Newton's iterations and aborts hopeless simulations early
+	class ConvergenceMonitor
+	{
+	public:
+		///Reason of abort
+		enum class Diagnosis
+		{
+			none,				///<Iterations may continue
+			divergence,			///<Residual is not finite or keeps growing far above it's smallest value
+			oscillation,		///<Residual jumps up and down without improving
+			stagnation,			///<Residual did not improve noticeably for too many iterations
+			iteration_budget,	///<Maximal number of iterations is reached
+			time_budget			///<Maximal time is exceeded
+		};
+
+	private:
+		std::vector<real> _residual;		///<Residual of every iteration since restart
+		uint _iterations = 0;				///<Number of all recorded residuals
+		uint _best = 0;						///<Iteration with smallest residual, later iterations must improve it noticeably to replace it
+		uint _newton_steps = 0;				///<Number of accepted Newton's modifications
+		uint _steps = 0;					///<Number of all steps, flow steps are made when Newton's modification is not adequate
+		uint _max_iterations;				///<Iteration budget
+		real _max_time;						///<Time budget in seconds, zero means unlimited
+		uint _stagnation_iterations;		///<Number of iterations without improvement that means stagnation
+		std::chrono::steady_clock::time_point _start;	///<Time of creation
+		Diagnosis _diagnosis = Diagnosis::none;			///<Last diagnosis
+
+	public:
+		ConvergenceMonitor(uint max_iterations, real max_time, uint stagnation_iterations) noexcept;	///<Creates monitor and starts it's clock
+		Diagnosis check(real residual)		noexcept;		///<Records residual of next iteration, returns diagnosis
+		void add_step(bool newton)			noexcept;		///<Records if Newton's modification was accepted or flow step was made
+		void restart()						noexcept;		///<Forgets residual history when equations change (for example load), budgets keep counting
+		Diagnosis stagnate()				noexcept;		///<Diagnoses stagnation when Newton's modification is negligible but forces are not balanced
+		uint get_iterations()				const noexcept;	///<Returns number of all recorded residuals
+		real get_acceptance_ratio()			const noexcept;	///<Returns part of steps that were Newton's modifications
+		Diagnosis get_diagnosis()			const noexcept;	///<Returns last diagnosis
+		String message()					const;			///<Returns human-readable description of last diagnosis
+	};
+
+	///Exception thrown by aborted simulation
+	class ConvergenceError : public std::runtime_error
+	{
+	private:
+		ConvergenceMonitor::Diagnosis _diagnosis;	///<Reason of abort
+
+	public:
+		ConvergenceError(const ConvergenceMonitor *monitor);				///<Creates exception with monitor's diagnosis and message
+		ConvergenceMonitor::Diagnosis diagnosis()	const noexcept;	///<Returns reason of abort
+	};
+}
+
+#endif
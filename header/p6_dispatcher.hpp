@@ -0,0 +1,69 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#ifndef P6_DISPATCHER
+#define P6_DISPATCHER
+
+#include "p6_common.hpp"
+#include "p6_snapshot.hpp"
+
+namespace p6
+{
+	///Chooses fastest way of solving snapshot by number of variables, sparsity, materials and available memory
+	///Costs are estimated per Newton's iteration in multiply-adds and converted to seconds with fixed rate
+	class Dispatcher
+	{
+	public:
+		///Way of solving linear system of Newton's iteration
+		enum class Backend
+		{
+			direct,				///<Sparse factorization in double precision
+			mixed_precision,	///<Sparse factorization in single precision with refinement in double
+			half_model,			///<Sparse factorization of half of mirror-symmetric construction
+			matrix_free,		///<Restarted GMRES without assembled matrix
+			decomposition		///<Sparse factorization of subdomains on separate threads with dense boundary
+		};
+
+		///Inspected properties of snapshot, choice and costs
+		struct Record
+		{
+			Backend backend = Backend::direct;	///<Chosen backend
+			bool linear_start = false;			///<Indicator if iterations start from small-displacement solution
+			uint variables = 0;					///<Number of variables
+			uint stored_values = 0;				///<Number of stored values of sparse derivative matrix
+			uint envelope = 0;					///<Number of entries of L within envelope
+			uint threads = 1;					///<Number of threads available to decomposition
+			uint boundary = 0;					///<Number of boundary variables of decomposition, zero if it was not considered
+			bool symmetric = false;				///<Indicator if construction is mirror-symmetric
+			bool linear = false;				///<Indicator if all materials are linear
+			real available_memory = 0.0;		///<Available memory in bytes, infinity if unknown
+			real estimated_time = 0.0;			///<Estimated time of Newton's iteration in seconds
+			real actual_time = 0.0;				///<Measured time of Newton's iteration in seconds, zero before solving
+			uint iterations = 0;				///<Number of Newton's iterations, zero before solving
+		};
+
+	private:
+		Record _record;					///<Properties, choice and costs
+		Snapshot::Options _options;		///<Options with chosen backend
+
+		static real _get_available_memory() noexcept;	///<Returns available physical memory in bytes, infinity if unknown
+
+	public:
+		Dispatcher(const Snapshot *snapshot, const Snapshot::Options *options);	///<Inspects snapshot and chooses backend, options give remaining parameters
+		Snapshot::Options get_options()		const noexcept;	///<Returns options with chosen backend
+		const Record *get_record()			const noexcept;	///<Returns properties, choice and costs
+		///Solves snapshot with chosen backend and measures time, iterations start from given solution or from small-displacement solution if it was chosen
+		Solution solve(const Snapshot *snapshot, const Solution *start = nullptr);
+		String message()					const;			///<Returns one-line description of choice and costs
+	};
+}
+
+#endif
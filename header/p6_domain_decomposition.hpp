@@ -0,0 +1,89 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#ifndef P6_DOMAIN_DECOMPOSITION
+#define P6_DOMAIN_DECOMPOSITION
+
+#include "p6_common.hpp"
+#include "p6_math.hpp"
+#include "p6_block_sparse_matrix.hpp"
+#include <vector>
+
+namespace p6
+{
+	///Domain decomposition of block sparse matrix for factorization on several threads
+	///Blocks are split into subdomains along breadth-first order, blocks coupled with later subdomain form interface boundary
+	///Interiors are factorized independently, boundary is solved with dense Schur complement S = A_bb - sum(A_bi * A_ii^-1 * A_ib)
+	class DomainDecomposition
+	{
+	private:
+		///Kind of stored value of original matrix
+		enum class Kind : unsigned char
+		{
+			interior,	///<Value of A_ii
+			right,		///<Value of A_ib
+			left,		///<Value of A_bi
+			boundary	///<Value of A_bb
+		};
+
+		///Place of stored value of original matrix in decomposition
+		struct Destination
+		{
+			Kind kind;			///<Kind of value
+			uint subdomain;		///<Subdomain of value, not used for boundary values
+			uint row;			///<Offset in interior matrix, index of coupling entry or row of boundary value
+			uint column;		///<Column of boundary value, not used for other values
+		};
+
+		///Non-zero value of coupling between interior and boundary
+		struct Entry
+		{
+			uint row;			///<Local row
+			uint column;		///<Local column
+			real value;			///<Value
+		};
+
+		///Interior of one subdomain and it's coupling with boundary
+		struct Subdomain
+		{
+			std::vector<uint> interior;		///<Original scalar index of each interior scalar
+			std::vector<uint> boundary;		///<Boundary index of each boundary scalar coupled with interior, sorted
+			BlockSparseMatrix matrix;		///<Interior matrix A_ii
+			std::vector<Entry> right;		///<Coupling A_ib, columns are coupled boundary scalars
+			std::vector<Entry> left;		///<Coupling A_bi, rows are coupled boundary scalars
+			Matrix schur;					///<A_bi * A_ii^-1 * A_ib
+			bool factorized = false;		///<Indicator if interior factorization succeeded
+		};
+
+		std::vector<Subdomain> _subdomain;		///<Subdomains with non-empty interior
+		std::vector<uint> _boundary;			///<Original scalar index of each boundary scalar
+		std::vector<Destination> _destination;	///<Destination of each stored value of original matrix
+		Matrix _schur;							///<Schur complement S
+		Eigen::PartialPivLU<Eigen::Matrix<real, Eigen::Dynamic, Eigen::Dynamic>> _lu;	///<Factorization of S
+		uint _size = 0;							///<Number of scalar rows of original matrix
+		uint _threads = 1;						///<Number of threads
+
+		static void _breadth_first(const std::vector<std::vector<uint>> *adjacency, uint root, std::vector<uint> *order, std::vector<bool> *visited);	///<Appends unvisited blocks reachable from root in breadth-first order
+		template <class F> void _parallel(F function) const;	///<Calls function(first, last) on ranges of subdomains on all threads
+
+	public:
+		///Splits pattern of matrix into given number of subdomains, zero means one per thread, zero threads means all cores
+		void create(const BlockSparseMatrix *d, uint subdomains = 0, uint threads = 0);
+		uint get_subdomain_count()				const noexcept;	///<Returns number of subdomains
+		uint get_interior_size(uint subdomain)	const noexcept;	///<Returns number of interior scalars of subdomain
+		uint get_boundary_size()				const noexcept;	///<Returns number of boundary scalars
+		real get_cost()							const noexcept;	///<Returns estimated number of multiply-adds of factorization and solution on longest thread and on boundary
+		bool factorize(const BlockSparseMatrix *d);				///<Factorizes matrix with the same pattern, returns false if some pivot is too small
+		void solve(const Vector *b, Vector *x)	const;			///<Solves system with factorized matrix
+	};
+}
+
+#endif
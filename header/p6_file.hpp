@@ -33,6 +33,8 @@ namespace p6
 	public:
 		InputFile(const String filepath);		///<Opens file for reading
 		bool ok() const noexcept;				///<Gets if file if ok
+		uint size();							///<Gets size of file in bytes
+		uint position();						///<Gets number of bytes read so far
 		void read(void *data, uint size);		///<Reads data drom file
 	};
 	
@@ -0,0 +1,78 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#ifndef P6_LINEAR_ANALYSIS
+#define P6_LINEAR_ANALYSIS
+
+#include "p6_common.hpp"
+#include "p6_snapshot.hpp"
+#include "p6_math.hpp"
+#include "p6_block_sparse_matrix.hpp"
+#include <vector>
+
+namespace p6
+{
+	class Material;
+
+	///Small-displacement analysis with stiffness of initial position, K * u = f
+	///Stiffness of every stick is k * b * b^T, so changing area or material of one stick is rank-one update of factorization
+	class LinearAnalysis
+	{
+	public:
+		///Consequence of removing one stick
+		struct Removal
+		{
+			bool mechanism = false;			///<Indicator if remaining construction is a mechanism
+			bool overstressed = false;		///<Indicator if stress in some remaining stick exceeds limit
+			real max_stress = 0.0;			///<Largest absolute stress in remaining sticks
+			uint critical_stick = (uint)-1;	///<Stick with largest absolute stress
+		};
+
+	private:
+		Snapshot _snapshot;						///<Analysed snapshot
+		std::vector<real> _area;				///<Current area of each stick
+		std::vector<const Material*> _material;	///<Current material of each stick
+		std::vector<real> _stiffness;			///<Axial stiffness k of each stick
+		std::vector<uint> _variable;			///<Up to four variables of each stick, -1 if absent
+		std::vector<real> _direction;			///<Entries of b of each stick, in order of variables
+		BlockSparseMatrix _k;					///<Stiffness matrix and it's L * D * L^T factorization
+		Vector _f;								///<External forces
+		Vector _u;								///<Displacements
+		bool _stable = false;					///<Indicator if stiffness matrix is positive definite
+		uint _update_count = 0;					///<Number of rank-one updates
+		uint _factorization_count = 0;			///<Number of full factorizations
+
+		real _get_stiffness(uint stick) const noexcept;	///<Returns axial stiffness of stick with current area and material
+		void _get_stick_vector(uint stick, std::vector<uint> *variable, std::vector<real> *direction) const;	///<Returns non-zero entries of b
+		void _factorize() noexcept;										///<Factorizes stiffness matrix and solves
+		void _update_stiffness(uint stick) noexcept;	///<Updates factorization with current stiffness of stick and solves
+		real _get_elongation(uint stick, const Vector *u) const noexcept;	///<Returns elongation of stick b^T * u
+		void _scan_redundancy(uint begin, uint end, real stress_limit, std::vector<Removal> *removal) const noexcept;	///<Analyses removal of sticks in range
+
+	public:
+		LinearAnalysis(const Snapshot *snapshot);								///<Assembles and factorizes stiffness matrix, superelements are not supported
+		void set_stick_area(uint stick, real area)					noexcept;	///<Changes area of stick
+		void set_stick_material(uint stick, const Material *material)	noexcept;	///<Changes material of stick
+		bool stable()										const noexcept;	///<Returns if stiffness matrix is positive definite
+		Coord get_node_displacement(uint node)				const noexcept;	///<Returns displacement of node
+		real get_stick_force(uint stick)					const noexcept;	///<Returns axial force of stick, positive in tension
+		uint get_update_count()								const noexcept;	///<Returns number of rank-one factorization updates
+		uint get_factorization_count()						const noexcept;	///<Returns number of full factorizations
+		///Analyses removal of every stick with Sherman-Morrison formula on intact factorization, in given number of threads (zero means all cores)
+		void scan_redundancy(real stress_limit, uint threads, std::vector<Removal> *removal) const;
+		///Returns forces of all sticks (rows) for given load at each of given nodes (columns), other loads are not applied
+		void get_influence_lines(const std::vector<uint> *node, Coord load, Matrix *force) const;
+		///Returns minimal and maximal force of each stick under existing loads and given load moving over given nodes
+		void get_force_envelope(const std::vector<uint> *node, Coord load, std::vector<real> *min, std::vector<real> *max) const;
+	};
+}
+
+#endif
@@ -28,6 +28,8 @@ namespace p6
 		virtual Type type() 							const noexcept;	///<Returns type of material
 		virtual real stress(real strain)				const noexcept;	///<Returns stress in dependence of strain
 		virtual real derivative(real strain)			const noexcept;	///<Returns derivative of stress by strain
+		///Returns stress and it's derivative by strain at once
+		virtual void calculate(real strain, real *stress, real *derivative) const noexcept;
 	};
 }
 
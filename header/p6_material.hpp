@@ -16,6 +16,7 @@
 namespace p6
 {
 	///Material, together with length defines properties of stick
+	///Materials have no mutable state and can be used by several threads at once
 	class Material
 	{
 	protected:
@@ -33,6 +34,8 @@ namespace p6
 		virtual Type type()					const noexcept = 0;	///<Returns type of material
 		virtual real stress(real strain)	const noexcept = 0;	///<Returns stress in dependence of strain
 		virtual real derivative(real strain)const noexcept = 0;	///<Returns derivative of stress by strain
+		///Returns stress and it's derivative by strain at once
+		virtual void calculate(real strain, real *stress, real *derivative) const noexcept = 0;
 		virtual ~Material()					noexcept = 0;		///<Destroys material
 	};
 }
@@ -0,0 +1,36 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+#ifndef P6_MATH
+#define P6_MATH
+
+#include "p6_common.hpp"
+#include <Eigen>
+
+namespace p6
+{
+	///Mathematical vector
+	class Vector : public Eigen::Vector<real, Eigen::Dynamic>
+	{
+	public:
+		using Eigen::Vector<p6::real, Eigen::Dynamic>::Vector;
+		using Eigen::Vector<p6::real, Eigen::Dynamic>::operator=;
+	};
+
+	///Mathematical matrix
+	class Matrix : public Eigen::Matrix<real, Eigen::Dynamic, Eigen::Dynamic>
+	{
+	public:
+		using Eigen::Matrix<p6::real, Eigen::Dynamic, Eigen::Dynamic>::Matrix;
+		using Eigen::Matrix<p6::real, Eigen::Dynamic, Eigen::Dynamic>::operator=;
+	};
+}
+
+#endif
@@ -26,15 +26,19 @@ namespace p6
 		wxMenuBar *_menu;							///<wxWidgets's menu
 		wxMenuItem *_file_load;						///<wxWidgets's "Load file" menu item
 		wxMenuItem *_file_import;					///<wxWidgets's "Import file" menu item
+		wxMenuItem *_file_import_superelement;		///<wxWidgets's "Import superelement" menu item
 		String _file;								///<Current file's path
 
 		void _on_file_load(wxCommandEvent &e);		///<Handles press on "file load" menu item, loads construction
 		void _on_file_import(wxCommandEvent &e);	///<Handles press on "file import" menu item, imports construction
+		void _on_file_import_superelement(wxCommandEvent &e);	///<Handles press on "import superelement" menu item, imports construction condensed to it's fixed nodes
 		void _on_file_save(wxCommandEvent &e);		///<Handles press on "file save" menu item, asks file name if unknown and saves construction
 		void _on_file_save_as(wxCommandEvent &e);	///<Handles press on "file save as" menu item, asks file name and saves construction to it
 		void _on_export_png(wxCommandEvent &e);		///<Handles press on "export PNG" menu item, saves construction image in PNG format
 		void _on_export_jpeg(wxCommandEvent &e);	///<Handles press on "export JPEG" menu item, saves construction image in JPEG format
 		void _on_view_grid(wxCommandEvent &e);		///<Handles press on "grid" menu item, turns grid on and off
+		void _on_trace_record(wxCommandEvent &e);	///<Handles press on "record" menu item, discards old events and starts recording, or stops recording
+		void _on_trace_save(wxCommandEvent &e);		///<Handles press on "save trace" menu item, asks file name and writes recorded events to it
 		void _on_help(wxCommandEvent &e);			///<Handles press on "help" menu item, displays help message
 		
 	public:
@@ -0,0 +1,48 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#ifndef P6_MODAL_ANALYSIS
+#define P6_MODAL_ANALYSIS
+
+#include "p6_common.hpp"
+#include <vector>
+
+namespace p6
+{
+	class Snapshot;
+	class Solution;
+
+	///Natural vibration modes around equilibrium, K * x = w^2 * M * x with tangent stiffness K and lumped mass M
+	///Modes closest to shift are found by Lanczos iterations with (K - shift * M)^-1 * M, which needs one sparse factorization
+	class ModalAnalysis
+	{
+	private:
+		std::vector<real> _mass;			///<Lumped mass of each node, half of mass of each attached stick
+		std::vector<real> _eigenvalue;		///<Square of circular frequency of each mode, negative for unstable (buckling) modes
+		std::vector<Coord> _shape;			///<Displacement of each node in each mode, mode after mode, modes are mass-normalized
+		uint _iterations = 0;				///<Number of Lanczos iterations
+		bool _converged = false;			///<Indicator if all requested modes converged
+
+	public:
+		///Finds given number of modes closest to shift in state of solution, density is given for every stick
+		///Throws if some free node has no mass or shifted stiffness matrix is singular
+		ModalAnalysis(const Snapshot *snapshot, const Solution *solution, const std::vector<real> *density, uint nmode, real shift = 0.0);
+		bool converged()								const noexcept;	///<Returns if all requested modes converged
+		uint get_iterations()							const noexcept;	///<Returns number of Lanczos iterations
+		uint get_mode_count()							const noexcept;	///<Returns number of found modes, they are sorted by eigenvalue
+		real get_eigenvalue(uint mode)					const noexcept;	///<Returns square of mode's circular frequency
+		real get_frequency(uint mode)					const noexcept;	///<Returns mode's circular frequency, zero for unstable modes
+		Coord get_mode_shape(uint mode, uint node)		const noexcept;	///<Returns node's displacement in mode
+		real get_node_mass(uint node)					const noexcept;	///<Returns node's lumped mass
+	};
+}
+
+#endif
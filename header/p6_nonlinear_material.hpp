@@ -69,13 +69,13 @@ namespace p6
 			real derivative;
 		};
 
-		mutable real _last_strain;									///<Last given strain
-		mutable real _last_stress;									///<Stress from last given strain
-		mutable real _last_derivative;								///<Derivative from last given strain
 		String _formula;											///<Formula of stress in dependence of strain
 		std::vector<Operation> _operations;							///<Translated byte-code of the formula
+		std::vector<real> _constants;								///<Constants of the formula in order of their PUTR operations
+		uint _depth = 0;											///<Maximal number of stack elements during calculation
 
-		void _calculate() const noexcept;							///<Calculates stress and derivative from strain
+		///Calculates stress and derivative from strain
+		void _calculate(real strain, real *stress, real *derivative) const noexcept;
 
 	public:
 		NonlinearMaterial(const String name, const String formula);	///<Creates material from stress from strain formula
@@ -83,6 +83,8 @@ namespace p6
 		virtual Type type()							const noexcept;	///<Returns type of material
 		virtual real stress(real strain)			const noexcept;	///<Returns stress in dependence of strain
 		virtual real derivative(real strain)		const noexcept;	///<Returns derivative of stress by strain
+		///Returns stress and it's derivative by strain at once
+		virtual void calculate(real strain, real *stress, real *derivative) const noexcept;
 	};
 }
 
@@ -0,0 +1,50 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#ifndef P6_REDUCED_MODEL
+#define P6_REDUCED_MODEL
+
+#include "p6_common.hpp"
+#include "p6_snapshot.hpp"
+#include "p6_block_sparse_matrix.hpp"
+#include "p6_math.hpp"
+#include <vector>
+
+namespace p6
+{
+	///Reduced-order model for load cases of one construction, built from proper orthogonal decomposition (POD) of sampled solutions
+	///State is s = s0 + V * q with orthonormal V, Newton's iterations solve Galerkin projection V^T * z(s0 + V * q) = 0
+	class ReducedModel
+	{
+	private:
+		std::vector<Vector> _sample;	///<Sampled displacements of state vector from initial state
+		Matrix _basis;					///<Orthonormal basis V, one column per mode
+		real _tolerance;				///<Accepted unbalanced force relative to largest unbalanced force of initial state
+		uint _reduced_count = 0;		///<Number of load cases solved in reduced space
+		uint _full_count = 0;			///<Number of load cases solved fully
+		BlockSparseMatrix _tangent;		///<Derivative of should-be-zero value, pattern is shared by all load cases
+		std::vector<uint> _scatter;		///<Offsets of sticks' derivatives in derivative
+
+	public:
+		ReducedModel(real tolerance = 1e-6)				noexcept;	///<Creates empty model with given tolerance of unbalanced forces
+		void add_sample(const Snapshot *snapshot, const Solution *solution);	///<Adds converged solution of snapshot to samples
+		uint get_sample_count()							const noexcept;	///<Returns number of samples
+		uint create_basis(real energy = 1.0 - 1e-9);				///<Creates basis capturing given part of samples' energy, returns number of modes
+		uint get_mode_count()							const noexcept;	///<Returns number of modes
+		///Solves snapshot with the same nodes and sticks as samples, but possibly different forces
+		///Solves fully, starting from reduced solution, if unbalanced forces of reduced solution are above tolerance
+		Solution solve(const Snapshot *snapshot, const Snapshot::Options *options = nullptr);
+		uint get_reduced_count()						const noexcept;	///<Returns number of load cases solved in reduced space
+		uint get_full_count()							const noexcept;	///<Returns number of load cases solved fully
+	};
+}
+
+#endif
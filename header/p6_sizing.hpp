@@ -0,0 +1,51 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#ifndef P6_SIZING
+#define P6_SIZING
+
+#include "p6_common.hpp"
+#include <vector>
+
+namespace p6
+{
+	class Construction;
+
+	///Minimal volume sizing of stick areas under stress limits (fully stressed design)
+	///Every stick's area is scaled by ratio of it's stress to limit of it's material, solves start from previous design's state
+	class Sizing
+	{
+	public:
+		///Record of one design iteration
+		struct Iteration
+		{
+			real volume;				///<Total volume of sticks before resizing
+			real max_ratio;				///<Largest ratio of stress to limit before resizing
+			uint solver_iterations;		///<Iterations of simulation
+		};
+
+	private:
+		std::vector<Iteration> _history;	///<Convergence history
+		real _solver_time = 0.0;			///<Total time of simulations in seconds
+		bool _converged = false;			///<Indicator if design is fully stressed
+
+	public:
+		///Resizes sticks of construction, stress limit is given for every material
+		///Areas stay between minimal area and twice or half of previous area, construction must not be simulated
+		Sizing(Construction *construction, const std::vector<real> *stress_limit, real min_area, real tolerance = 1e-3, uint max_iterations = 100);
+		bool converged()					const noexcept;	///<Returns if all sticks are fully stressed or at minimal area
+		uint get_iteration_count()			const noexcept;	///<Returns number of design iterations
+		Iteration get_iteration(uint index)	const noexcept;	///<Returns record of design iteration
+		real get_solver_time()				const noexcept;	///<Returns total time of simulations in seconds
+	};
+}
+
+#endif
@@ -0,0 +1,275 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+#ifndef P6_SNAPSHOT
+#define P6_SNAPSHOT
+
+#include "p6_common.hpp"
+#include "p6_material.hpp"
+#include "p6_solution.hpp"
+#include <vector>
+
+namespace p6
+{
+	class Construction;
+	class Vector;
+	class Matrix;
+	class BlockSparseMatrix;
+
+	///Immutable copy of construction that can be simulated by several threads at once
+	///Materials are shared with construction, so snapshot must not outlive changes of construction's materials
+	class Snapshot
+	{
+	public:
+		///Way of solving linear system of Newton's iteration
+		enum class Method
+		{
+			direct,			///<Factorization of assembled derivative matrix
+			matrix_free,	///<Restarted GMRES with derivative-vector products computed stick by stick, matrix is never stored
+			decomposition,	///<Factorization of subdomains on separate threads and of dense Schur complement of their boundary
+			automatic		///<Chosen by Dispatcher from size, sparsity and materials of construction
+		};
+
+		///Progress of one iteration of simulation
+		struct Iteration
+		{
+			uint iteration = 0;			///<Number of iteration, starting from one
+			uint step = 0;				///<Load step, starting from one
+			real residual = 0.0;		///<Largest unbalanced force before iteration
+			bool newton = false;		///<Indicator if Newton's modification was accepted, flow step was made otherwise
+			real step_norm = 0.0;		///<Norm of change of state vector
+			real time = 0.0;			///<Seconds since beginning of simulation
+		};
+
+		///Receiver of simulation's progress, it is called from the thread simulation runs in
+		class Observer
+		{
+		public:
+			virtual void observe(const Iteration *iteration) = 0;	///<Receives progress after every iteration
+			virtual ~Observer() noexcept {}							///<Destroys observer
+		};
+
+		///Parameters of simulation
+		struct Options
+		{
+			Method method = Method::automatic;	///<Way of solving linear system
+			uint krylov_restart = 50;			///<Number of GMRES iterations between restarts
+			uint krylov_iterations = 1000;		///<Maximal number of GMRES iterations per Newton's iteration
+			real krylov_tolerance = 1e-10;		///<Relative residual GMRES stops at
+			bool mixed_precision = false;		///<Factorize in single precision and refine in double, falls back to double factorization if refinement stalls
+			bool scaling = true;				///<Equilibrate rows and columns of direct system and accept nondimensional convergence
+			bool symmetry = true;				///<Solve half of mirror-symmetric construction when solving directly
+			uint subdomains = 0;				///<Number of subdomains of decomposition method, zero means one per thread
+			uint threads = 0;					///<Number of threads of decomposition method, zero means all cores
+			real relative_tolerance = 1e-9;		///<Nondimensional tolerance of unbalanced forces (relative to forces in the same equation) and of Newton's modification (relative to shortest stick)
+			real reassembly_threshold = 0.0;	///<Movement of stick's end (relative to it's length) below which it's derivatives are kept from previous iterations, zero reassembles all sticks
+			uint max_iterations = 10000;		///<Iteration budget, simulation is aborted when it is exceeded
+			real max_time = 0.0;				///<Time budget in seconds, zero means unlimited
+			uint stagnation_iterations = 200;	///<Number of iterations without noticeable decrease of unbalanced forces after which simulation is aborted
+			uint load_steps = 1;				///<Number of equal load increments, equilibrium of each is found starting from previous one
+			String checkpoint_path;				///<File solver state is periodically saved to, empty disables checkpoints
+			real checkpoint_interval = 60.0;	///<Seconds between checkpoints, state is also saved after every load step
+			Observer *observer = nullptr;		///<Receiver of every iteration's progress, null disables observation
+		};
+
+		///Response of construction whose sensitivity is calculated
+		struct Response
+		{
+			///Type of response
+			enum class Type
+			{
+				compliance,			///<Work of external forces on displacements
+				node_displacement,	///<Displacement of node in direction
+				stick_force			///<Force of stick
+			};
+
+			Type type = Type::compliance;	///<Type of response
+			uint index = 0;					///<Node or stick
+			Coord direction;				///<Direction of node displacement
+		};
+
+	private:
+		///Node data
+		struct Node
+		{
+			unsigned char freedom;
+			real angle;
+			Coord coord;
+			uint free;		///<Index among fully free or free along rail nodes, set by _create_map
+		};
+
+		///Stick data
+		struct Stick
+		{
+			uint node[2];
+			const Material *material;
+			real area;
+			real initial_length;
+		};
+
+		///Force data
+		struct Force
+		{
+			uint node;
+			Coord direction;
+		};
+
+		///Superelement data, condensed block rotated to construction's axes
+		struct Superelement
+		{
+			std::vector<uint> node;		///<Boundary nodes
+			std::vector<real> tangent;	///<Condensed derivative of should-be-zero value, row-major, two rows per boundary node
+			std::vector<real> force;	///<Condensed should-be-zero value in initial position, two per boundary node
+		};
+
+		///Header of checkpoint file, followed by state vector
+		struct Checkpoint
+		{
+			char signature[8] = { 'P', '6', 'C', 'H', 'K', 'P', '0', '\0' };
+			uint map_hash;		///<Hash of node-to-free map
+			uint variables;		///<Number of variables
+			uint step;			///<Load step being solved, one-based, larger than number of steps if all are solved
+			uint steps;			///<Number of load steps
+			uint iterations;	///<Number of performed iterations
+			real factor;		///<Load factor of step being solved, checked when resuming
+		};
+
+		std::vector<Node> _node;	///<List of all nodes
+		std::vector<Stick> _stick;	///<List of all sticks
+		std::vector<Force> _force;	///<List of all forces
+		std::vector<Superelement> _superelement;	///<List of all superelements
+		uint _nfree2d;				///<Number of fully free nodes, set by _create_map
+		uint _nfree1d;				///<Number of free along rail nodes, set by _create_map
+		Statistics _statistics;		///<Wall time of creation of node-to-free map
+
+		uint _node_equation_fx(uint free2d)	const noexcept;	///<Returns equation index of horizontal node force balance
+		uint _node_equation_fy(uint free2d)	const noexcept;	///<Returns equation index of vertical node force balance
+		uint _node_equation_fr(uint free1d)	const noexcept;	///<Returns equation index of node force balance along it's rail
+		uint _equation_number()				const noexcept;	///<Returns equation number
+		uint _node_variable_x(uint free2d)	const noexcept;	///<Returns variable index of node's X coordinate
+		uint _node_variable_y(uint free2d)	const noexcept;	///<Returns variable index of node's Y coordinate
+		uint _node_variable_r(uint free1d)	const noexcept;	///<Returns variable index of node's coordinate along it's rail
+		uint _variable_number()				const noexcept;	///<Returns variable number
+		void _create_map()					noexcept;		///<Creates node-to-free map
+		real _get_tolerance()				const noexcept;	///<Returns force tolerance
+		void _get_node_equation(uint node, uint equation[2])	const noexcept;	///<Returns equation indexes of node's force balance, -1 if absent
+
+		uint _node_block(uint node)			const noexcept;	///<Returns block row and column of node in derivative matrix, -1 if node is fixed
+		void _create_pattern(BlockSparseMatrix *d)	const noexcept;	///<Creates block pattern of derivative matrix
+		///Creates state, should-be-zero, modification vectors and derivative matrix
+		void _create_vectors(Vector *s, Vector *z, Vector *m, BlockSparseMatrix *d) const noexcept;
+		///Sets should-be-zero value to external forces multiplied by load factor
+		void _set_z_to_external_forces(Vector *z, real factor) const noexcept;
+		///Sets derivative of shoud-be-zero to zero
+		void _set_d_to_zero(BlockSparseMatrix *d) const noexcept;
+		///Gets coordinate of node
+		Coord _get_coord(uint node, const Vector *s) const noexcept;
+		///Gets coordinate difference between two nodes
+		Coord _get_delta(uint stick, const Vector *s) const noexcept;
+		///Modifies should-be-zero value with force of some stick
+		void _modify_z_with_stick_force(uint stick, const Vector *s, Vector *z) const noexcept;
+		///Finds offsets of derivatives of sticks' forces in derivative matrix, 16 per stick
+		void _create_scatter(const BlockSparseMatrix *d, std::vector<uint> *scatter) const noexcept;
+		///Gets 16 derivatives of force of some stick in order of scatter
+		void _get_stick_derivative(uint stick, const Vector *s, real derivative[16]) const noexcept;
+		///Modifies derivative of should-be-zero with derivatives of force of some stick, using offsets from scatter
+		void _modify_d_with_stick_force(uint stick, const Vector *s, const uint *scatter, BlockSparseMatrix *d) const noexcept;
+		///Replaces previously assembled derivatives of force of some stick with current ones
+		void _reassemble_d_with_stick_force(uint stick, const Vector *s, const uint *scatter, real assembled[16], BlockSparseMatrix *d) const noexcept;
+		///Modifies should-be-zero value with forces of some superelement, it's condensed loads are multiplied by load factor
+		void _modify_z_with_superelement(uint superelement, const Vector *s, real factor, Vector *z) const noexcept;
+		///Modifies derivative of should-be-zero with derivatives of forces of some superelement
+		void _modify_d_with_superelement(uint superelement, BlockSparseMatrix *d) const noexcept;
+		///Gets variation of node's coordinate correspondent to variation of state vector
+		Coord _get_variation(uint node, const Vector *v) const noexcept;
+		///Adds force applied to node to should-be-zero value, projecting it on rail if needed
+		void _add_node_force(uint node, Coord force, Vector *z) const noexcept;
+		///Multiplies derivative of force of some stick by vector and adds result
+		void _multiply_d_with_stick_force(uint stick, const Vector *s, const Vector *v, Vector *dv) const noexcept;
+		///Multiplies derivative of forces of some superelement by vector and adds result
+		void _multiply_d_with_superelement(uint superelement, const Vector *v, Vector *dv) const noexcept;
+		///Modifies diagonal of derivative of should-be-zero with derivatives of force of some stick
+		void _modify_diagonal_with_stick_force(uint stick, const Vector *s, Vector *diagonal) const noexcept;
+		///Modifies diagonal of derivative of should-be-zero with derivatives of forces of some superelement
+		void _modify_diagonal_with_superelement(uint superelement, Vector *diagonal) const noexcept;
+		///Multiplies derivative of should-be-zero by vector
+		void _multiply_d(const Vector *s, const Vector *v, Vector *dv) const noexcept;
+		///Solves d * m = z with Jacobi-preconditioned restarted GMRES without assembling d, returns number of GMRES iterations
+		uint _solve_matrix_free(const Vector *s, const Vector *z, const Options *options, Vector *m) const noexcept;
+		///Gets residuum
+		real _get_residuum(const Vector *z) const noexcept;
+		///Gets largest unbalanced force relative to magnitude of forces acting in the same equation
+		real _get_relative_residuum(const Vector *s, const Vector *z) const noexcept;
+		///Gets largest unbalanced force relative to rounding error of forces acting in the same equation
+		real _get_rounding_residuum(const Vector *s, const Vector *z) const noexcept;
+		///Gets largest modification of coordinate relative to shortest stick
+		real _get_relative_modification(const Vector *m) const noexcept;
+		///Decides if Newton's modification is adequate
+		bool _is_adequate(const Vector *m, const Vector *s) const noexcept;
+		///Gets largest part of Newton's modification that is adequate, zero if modification is not finite
+		real _get_adequate_fraction(const Vector *m, const Vector *s) const noexcept;
+		///Gets flow coefficient
+		real _get_flow_coefficient(const Vector *s, const Vector *z) const noexcept;
+		///Writes data correspondent to state vector to solution
+		void _apply_state_vector(const Vector *s, Solution *solution) const noexcept;
+		///Gets derivative of response by state vector and derivatives by area and stress scale of stick the response depends on directly
+		void _get_response_derivative(const Response *response, const Vector *s, Vector *g, real *area, real *scale) const noexcept;
+		///Gets work of stick's forces per unit area on nodes on virtual displacements
+		real _get_stick_work(uint stick, const Vector *s, const Vector *v) const noexcept;
+		///Gets should-be-zero value with external forces multiplied by load factor
+		void _get_residual(const Vector *s, real factor, Vector *z) const noexcept;
+		///Gets hash of node-to-free map, checkpoint can be resumed only by snapshot with the same map
+		uint _get_map_hash() const noexcept;
+		///Saves solver state to checkpoint file
+		void _save_checkpoint(const String filepath, uint step, uint steps, uint iterations, const Vector *s) const;
+		///Simulates from given state, load steps from first to last, number of iterations before start is given
+		Solution _solve(const Options *options, const Vector *start, uint first_step, uint steps, uint iterations) const;
+
+	public:
+		Snapshot(const Construction *construction);	///<Copies construction, throws if it can not be simulated
+		uint get_node_count()			const noexcept;	///<Returns node number
+		uint get_stick_count()			const noexcept;	///<Returns stick number
+		uint get_force_count()			const noexcept;	///<Returns force number
+		unsigned char get_node_freedom(uint node)		const noexcept;	///<Returns node's degree of freedom
+		Coord get_node_coord(uint node)					const noexcept;	///<Returns node's initial coordinates
+		real get_node_rail_angle(uint node)				const noexcept;	///<Returns node's rail angle (for nodes fixed on rail)
+		void get_stick_node(uint stick, uint node[2])	const noexcept;	///<Returns nodes stick is attached to
+		const Material *get_stick_material(uint stick)	const noexcept;	///<Returns stick's material
+		real get_stick_area(uint stick)					const noexcept;	///<Returns stick's cross-sectional area
+		uint get_force_node(uint force)					const noexcept;	///<Returns node force is attached to
+		Coord get_force_direction(uint force)			const noexcept;	///<Returns force's direction
+		uint get_variable_number()						const noexcept;	///<Returns number of variables (degrees of freedom)
+		void get_node_variable(uint node, uint variable[2])	const noexcept;	///<Returns variable indexes of node's coordinates, -1 if absent
+		uint get_superelement_count()					const noexcept;	///<Returns superelement number
+		uint get_superelement_node_count(uint superelement)				const noexcept;	///<Returns number of superelement's boundary nodes
+		uint get_superelement_node(uint superelement, uint index)		const noexcept;	///<Returns superelement's boundary node
+		void get_initial_state(Vector *s)								const noexcept;	///<Returns state vector of initial position
+		void get_state(const Solution *solution, Vector *s)				const noexcept;	///<Returns state vector of solution's position
+		void get_residual(const Vector *s, Vector *z)					const noexcept;	///<Returns should-be-zero value (unbalanced forces) in state
+		void get_tangent(const Vector *s, Matrix *d)					const noexcept;	///<Returns derivative of should-be-zero value in state
+		void get_tangent(const Vector *s, BlockSparseMatrix *d)			const noexcept;	///<Returns derivative of should-be-zero value in state as sparse matrix
+		///Creates pattern of sparse derivative and offsets of sticks' derivatives in it, both fit all snapshots with the same nodes, sticks and superelements
+		void create_tangent(BlockSparseMatrix *d, std::vector<uint> *scatter) const noexcept;
+		///Returns derivative of should-be-zero value in state into matrix created by create_tangent, pattern is kept
+		void get_tangent(const Vector *s, const std::vector<uint> *scatter, BlockSparseMatrix *d) const noexcept;
+		Solution get_solution(const Vector *s)							const noexcept;	///<Returns solution in state, equilibrium is not checked
+		///Checks stability and simulates construction (half of it if it is mirror-symmetric, solved directly and symmetry is enabled), does not change snapshot
+		///Throws ConvergenceError if simulation diverges, oscillates, stagnates or exceeds it's budget
+		///Iterations start from state of given solution of snapshot with the same nodes, for example after changing areas
+		Solution solve(const Options *options = nullptr, const Solution *start = nullptr)	const;
+		///Continues simulation from checkpoint file saved by snapshot with the same nodes, remaining load steps are solved
+		Solution resume(const String filepath, const Options *options = nullptr)	const;
+		///Returns derivatives of response by area and by modulus (initial slope of stress-strain curve, curve is scaled) of every stick
+		///Uses adjoint method, needs one factorization and one solve in solution's state. Derivative by modulus is zero for materials with zero initial slope
+		void get_sensitivity(const Solution *solution, const Response *response, std::vector<real> *area, std::vector<real> *modulus) const;
+	};
+}
+
+#endif
@@ -0,0 +1,48 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+#ifndef P6_SOLUTION
+#define P6_SOLUTION
+
+#include "p6_common.hpp"
+#include "p6_statistics.hpp"
+#include <vector>
+
+namespace p6
+{
+	///Result of simulation, independent from construction and snapshot it was obtained from
+	class Solution
+	{
+	private:
+		friend class Snapshot;
+
+		std::vector<Coord> _coord;	///<Simulated coordinates of nodes
+		std::vector<real> _strain;	///<Strains of sticks
+		std::vector<real> _force;	///<Forces of sticks
+		std::vector<real> _state;	///<Converged state vector
+		uint _iterations = 0;		///<Number of performed iterations
+		uint _krylov_iterations = 0;	///<Number of performed GMRES iterations in matrix-free mode
+		Statistics _statistics;		///<Wall time and calls of simulation's phases
+		String _warning;			///<Problem found before simulation that did not prevent convergence
+
+	public:
+		uint get_node_count()				const noexcept;	///<Returns node number
+		uint get_stick_count()				const noexcept;	///<Returns stick number
+		Coord get_node_coord(uint node)		const noexcept;	///<Returns node's simulated coordinates
+		real get_stick_strain(uint stick)	const noexcept;	///<Returns stick's strain
+		real get_stick_force(uint stick)	const noexcept;	///<Returns stick's force
+		uint get_iterations()				const noexcept;	///<Returns number of performed iterations
+		uint get_krylov_iterations()		const noexcept;	///<Returns number of performed GMRES iterations in matrix-free mode
+		const Statistics *get_statistics()	const noexcept;	///<Returns wall time and calls of simulation's phases, they are zero if statistics are disabled
+		String get_warning()				const;			///<Returns problem found before simulation, empty if there was none
+	};
+}
+
+#endif
@@ -0,0 +1,59 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+#ifndef P6_STABILITY
+#define P6_STABILITY
+
+#include "p6_common.hpp"
+#include <vector>
+
+namespace p6
+{
+	class Snapshot;
+
+	///Fast structural stability analysis, detects mechanisms before simulation
+	class Stability
+	{
+	private:
+		///Graph used for pebble game, supports are represented with edges to two ground vertices
+		struct Graph
+		{
+			std::vector<uint> pebble;		///<Two entries per vertex: target of edge covered by pebble or -1 if pebble is free
+			std::vector<uint> visit;		///<Visit marks of breadth-first search
+			std::vector<uint> parent;		///<Parent vertex during breadth-first search
+			std::vector<uint> queue;		///<Queue of breadth-first search
+			uint mark = 0;					///<Current visit mark
+		};
+
+		bool _combinatorial = true;			///<Indicator if stick graph has enough independent sticks
+		bool _geometric = true;				///<Indicator if rigidity matrix in initial position has full rank
+		uint _degrees = 0;					///<Number of mechanism's degrees of freedom
+		std::vector<uint> _node;			///<Nodes that can move without deforming sticks
+
+		static uint _free_pebbles(const Graph *graph, uint vertex) noexcept;						///<Returns number of free pebbles on vertex
+		static bool _gather_pebble(Graph *graph, uint vertex, const uint blocked[2]) noexcept;	///<Moves free pebble to vertex without touching blocked vertices
+		static bool _add_edge(Graph *graph, uint a, uint b) noexcept;							///<Adds edge if it is independent
+		static void _get_bars(const Snapshot *snapshot, std::vector<uint> *bars);		///<Returns node pairs of sticks and virtual bars that keep superelements rigid
+		void _pebble_game(const Snapshot *snapshot);			///<Checks combinatorial (generic) rigidity
+		void _rank_check(const Snapshot *snapshot);				///<Checks rank of rigidity matrix R by factorizing R^T * R
+
+	public:
+		Stability(const Snapshot *snapshot);				///<Analyses stability of snapshot
+		bool stable()						const noexcept;	///<Returns if construction is not a mechanism
+		bool combinatorial()				const noexcept;	///<Returns if construction has enough properly placed sticks and supports
+		bool geometric()					const noexcept;	///<Returns if construction is not a mechanism in it's initial position
+		uint get_degrees()					const noexcept;	///<Returns number of mechanism's degrees of freedom
+		uint get_node_count()				const noexcept;	///<Returns number of nodes that can move freely
+		uint get_node(uint index)			const noexcept;	///<Returns node that can move freely
+		String message()					const;			///<Returns human-readable description of the problem
+	};
+}
+
+#endif
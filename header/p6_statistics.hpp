@@ -0,0 +1,78 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#ifndef P6_STATISTICS
+#define P6_STATISTICS
+
+#include "p6_common.hpp"
+#ifdef P6_SIMULATION_STATISTICS
+	#include <chrono>
+#endif
+
+namespace p6
+{
+	///Wall time and number of calls of simulation's phases, collected only if P6_SIMULATION_STATISTICS is defined
+	struct Statistics
+	{
+		///Wall time and number of calls of one phase
+		struct Phase
+		{
+			real time = 0.0;	///<Wall time in seconds
+			uint calls = 0;		///<Number of calls
+		};
+
+		#ifdef P6_SIMULATION_STATISTICS
+			static const bool enabled = true;	///<Indicator if statistics are collected
+		#else
+			static const bool enabled = false;	///<Indicator if statistics are collected
+		#endif
+
+		Phase create_map;		///<Creation of node-to-free map
+		Phase create_vectors;	///<Creation of vectors and of matrix pattern
+		Phase assembly;			///<Assembly of unbalanced forces and their derivatives
+		Phase factorization;	///<Factorization and solution of linear system, GMRES in matrix-free mode
+		Phase adequacy;			///<Checks of Newton's modifications
+		Phase flow;				///<Calculation of flow coefficients
+		Phase apply;			///<Application of state vector to solution
+		uint newton_steps = 0;	///<Number of accepted Newton's steps
+		uint flow_steps = 0;	///<Number of fallback flow steps
+	};
+
+	///Adds wall time between start and stop and one call to phase, compiles to nothing if statistics are disabled
+	class Stopwatch
+	{
+	#ifdef P6_SIMULATION_STATISTICS
+	private:
+		Statistics::Phase *_phase = nullptr;				///<Measured phase
+		std::chrono::steady_clock::time_point _start;		///<Beginning of measurement
+
+	public:
+		///Starts measuring phase
+		void start(Statistics::Phase *phase) noexcept
+		{
+			_phase = phase;
+			_start = std::chrono::steady_clock::now();
+		}
+		///Adds measured time and one call to phase
+		void stop() noexcept
+		{
+			_phase->time += std::chrono::duration<real>(std::chrono::steady_clock::now() - _start).count();
+			_phase->calls++;
+		}
+	#else
+	public:
+		void start(Statistics::Phase *)	noexcept {}	///<Does nothing
+		void stop()						noexcept {}	///<Does nothing
+	#endif
+	};
+}
+
+#endif
@@ -0,0 +1,59 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+#ifndef P6_SYMMETRY
+#define P6_SYMMETRY
+
+#include "p6_common.hpp"
+#include <vector>
+
+namespace p6
+{
+	class Snapshot;
+	class Vector;
+	class BlockSparseMatrix;
+
+	///Mirror symmetry about vertical axis, reduces system to half model
+	///Full variables are expressed through reduced ones as s = T * r, where every row of T has at most one non-zero entry
+	class Symmetry
+	{
+	private:
+		bool _symmetric = false;			///<Indicator if geometry, supports, sticks and loads are mirror-symmetric
+		real _axis = 0.0;					///<X coordinate of symmetry axis
+		std::vector<uint> _mirror;			///<Mirror node of each node
+		std::vector<uint> _reduced;			///<Reduced variable of each full variable or -1 if variable is zero by symmetry
+		std::vector<real> _sign;			///<Entry of T in row of each full variable
+		std::vector<real> _weight;			///<Diagonal of T^T * T
+		uint _nreduced = 0;					///<Number of reduced variables
+		std::vector<uint> _block_size;		///<Size of each block of reduced matrix, block is formed by node and it's mirror
+		std::vector<uint> _reduced_block;	///<Block of each reduced variable
+		std::vector<uint> _target;			///<Offset in reduced matrix of each stored value of full matrix or -1 if value is dropped
+		std::vector<real> _factor;			///<Product of entries of T each stored value of full matrix is multiplied with
+
+		bool _find_mirrors(const Snapshot *snapshot, real tolerance) noexcept;		///<Finds mirror nodes, returns if all nodes have mirror
+		bool _check_sticks(const Snapshot *snapshot) const noexcept;				///<Returns if all sticks have mirror
+		bool _check_forces(const Snapshot *snapshot) const noexcept;				///<Returns if all loads are mirror-symmetric
+		bool _create_reduction(const Snapshot *snapshot) noexcept;					///<Creates T, returns if all supports are mirror-symmetric
+
+	public:
+		Symmetry(const Snapshot *snapshot)	noexcept;	///<Analyses symmetry of snapshot
+		bool symmetric()					const noexcept;	///<Returns if construction is mirror-symmetric
+		real get_axis()						const noexcept;	///<Returns X coordinate of symmetry axis
+		uint get_mirror(uint node)			const noexcept;	///<Returns mirror node
+		uint get_variable_number()			const noexcept;	///<Returns number of reduced variables
+		void reduce_vector(const Vector *z, Vector *reduced)	const noexcept;	///<Returns T^T * z
+		void create_reduced_matrix(const BlockSparseMatrix *d, BlockSparseMatrix *reduced);	///<Creates sparse pattern of T^T * d * T and remembers where values of d go
+		void reduce_matrix(const BlockSparseMatrix *d, BlockSparseMatrix *reduced)	const noexcept;	///<Returns T^T * d * T, reduced must be created from d
+		void expand_vector(const Vector *reduced, Vector *m)	const noexcept;	///<Returns T * reduced
+		void project_vector(const Vector *z, Vector *p)			const noexcept;	///<Returns symmetric part of z, T * (T^T * T)^-1 * T^T * z
+	};
+}
+
+#endif
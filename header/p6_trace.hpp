@@ -0,0 +1,85 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#ifndef P6_TRACE
+#define P6_TRACE
+
+#include "p6_common.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace p6
+{
+	///Recorder of timed events of all threads, written in Chrome trace format (chrome://tracing, ui.perfetto.dev)
+	///Every thread appends to it's own buffer without locking, buffers are only read when trace is written
+	class Trace
+	{
+	private:
+		///Complete event
+		struct Event
+		{
+			const char *name;		///<Name of event, string literal
+			long long begin;		///<Beginning in nanoseconds since start of recording
+			long long duration;		///<Duration in nanoseconds
+		};
+
+		///Fixed-size part of thread's buffer, it is never moved, so it can be read while it is filled
+		struct Block
+		{
+			static const uint capacity = 4096;		///<Number of events in block
+			Event event[capacity];					///<Events
+			std::atomic<uint> count;				///<Number of written events, published after event is written
+			std::atomic<Block*> next;				///<Next block or null
+			Block() noexcept;						///<Creates empty block
+		};
+
+		///Events of one thread
+		struct Buffer
+		{
+			Block *first;		///<First block
+			Block *last;		///<Block being filled, used only by owning thread and by clear
+			uint thread;		///<Index of thread in trace
+		};
+
+		static std::atomic<bool> _enabled;							///<Indicator if events are recorded
+		static std::chrono::steady_clock::time_point _start;		///<Start of recording
+		static std::mutex _mutex;									///<Protects list of buffers, locked once per thread and when trace is written
+		static std::vector<Buffer*> _buffer;						///<Buffers of all threads that recorded events, they live until program ends
+
+		static Buffer *_get_buffer() noexcept;	///<Returns buffer of calling thread, creates it on first call, returns null if memory is exhausted
+
+	public:
+		static void enable(bool enable) noexcept;	///<Starts or stops recording events
+		static bool enabled() noexcept;				///<Returns if events are recorded
+		///Records event of calling thread, name must live until trace is written, event is dropped if memory is exhausted
+		static void record(const char *name, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) noexcept;
+		static uint get_event_count();				///<Returns number of recorded events of all threads
+		static void clear();						///<Discards recorded events and frees their blocks, buffers of threads are kept, other threads must not record meanwhile
+		static void write(const String filepath);	///<Writes all recorded events as Chrome trace JSON, other threads may continue recording
+	};
+
+	///Event lasting from construction to destruction of object, recorded only if trace is enabled
+	class TraceScope
+	{
+	private:
+		const char *_name;										///<Name of event, string literal
+		std::chrono::steady_clock::time_point _begin;			///<Beginning of event
+		bool _enabled;											///<Indicator if trace was enabled at beginning
+
+	public:
+		TraceScope(const char *name) noexcept;	///<Begins event with given name
+		~TraceScope() noexcept;					///<Ends and records event
+	};
+}
+
+#endif
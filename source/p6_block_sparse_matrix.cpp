@@ -0,0 +1,714 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+#include "../header/p6_block_sparse_matrix.hpp"
+#include "../header/p6_math.hpp"
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void p6::BlockSparseMatrix::_create_envelope() noexcept
+{
+	//Reverse Cuthill-McKee ordering of blocks, every component starts with block of minimal degree
+	uint nblock = _size.size();
+	std::vector<uint> order;
+	std::vector<bool> visited(nblock, false);
+	order.reserve(nblock);
+	while (order.size() < nblock)
+	{
+		uint start = (uint)-1;
+		for (uint i = 0; i < nblock; i++)
+		{
+			if (!visited[i] && (start == (uint)-1 || _row[i + 1] - _row[i] < _row[start + 1] - _row[start])) start = i;
+		}
+		visited[start] = true;
+		order.push_back(start);
+		for (uint head = order.size() - 1; head < order.size(); head++)
+		{
+			uint current = order[head];
+			uint first_neighbor = order.size();
+			for (uint i = _row[current]; i < _row[current + 1]; i++)
+			{
+				if (visited[_column[i]]) continue;
+				visited[_column[i]] = true;
+				order.push_back(_column[i]);
+			}
+			std::sort(order.begin() + first_neighbor, order.end(), [this](uint a, uint b) { return _row[a + 1] - _row[a] < _row[b + 1] - _row[b]; });
+		}
+	}
+	std::reverse(order.begin(), order.end());
+	std::vector<uint> position(nblock);
+	for (uint i = 0; i < nblock; i++) position[order[i]] = i;
+
+	//Scalar permutation, blocks stay contiguous
+	uint n = get_size();
+	std::vector<uint> reordered_start(nblock);
+	_permutation.resize(n);
+	for (uint i = 0, k = 0; i < nblock; i++)
+	{
+		reordered_start[i] = k;
+		for (uint j = _start[order[i]]; j < _start[order[i] + 1]; j++) _permutation[k++] = j;
+	}
+	_position.resize(n);
+	for (uint i = 0; i < n; i++) _position[_permutation[i]] = i;
+
+	//Envelope is defined by blocks, so every scalar of block row has the same first index
+	_first.resize(n);
+	_envelope.resize(n + 1);
+	_envelope[0] = 0;
+	for (uint i = 0; i < nblock; i++)
+	{
+		uint first_block = i;
+		for (uint j = _row[order[i]]; j < _row[order[i] + 1]; j++) first_block = std::min(first_block, position[_column[j]]);
+		for (uint k = reordered_start[i]; k < reordered_start[i] + _size[order[i]]; k++)
+		{
+			_first[k] = reordered_start[first_block];
+			_envelope[k + 1] = _envelope[k] + (k - _first[k]);
+		}
+	}
+	_column_end.resize(n);
+	for (uint k = 0; k < n; k++) _column_end[k] = k + 1;
+	for (uint k = 0; k < n; k++)
+	{
+		for (uint j = _first[k]; j < k; j++) _column_end[j] = k + 1;
+	}
+	_factorized = false;
+	_reusable = false;
+}
+
+p6::uint p6::BlockSparseMatrix::_get_changed_start() const noexcept
+{
+	//Factors of row and column k depend only on leading submatrix of size k + 1
+	uint start = get_size();
+	for (uint i = 0; i < _size.size(); i++)
+	{
+		for (uint j = _row[i]; j < _row[i + 1]; j++)
+		{
+			uint block_column = _column[j];
+			for (uint r = 0; r < _size[i]; r++)
+			{
+				for (uint c = 0; c < _size[block_column]; c++)
+				{
+					uint offset = _offset[j] + r * _size[block_column] + c;
+					if (_value[offset] != _factorized_value[offset])
+						start = std::min(start, std::max(_position[_start[i] + r], _position[_start[block_column] + c]));
+				}
+			}
+		}
+	}
+	return start;
+}
+
+void p6::BlockSparseMatrix::create(const std::vector<uint> &size, const std::vector<uint> &pattern) noexcept
+{
+	uint nblock = size.size();
+	_size = size;
+	_start.resize(nblock + 1);
+	_start[0] = 0;
+	for (uint i = 0; i < nblock; i++) _start[i + 1] = _start[i] + size[i];
+	_block.resize(_start[nblock]);
+	for (uint i = 0; i < nblock; i++)
+	{
+		for (uint j = _start[i]; j < _start[i + 1]; j++) _block[j] = i;
+	}
+
+	//Symmetric block pattern with diagonal
+	std::vector<std::vector<uint>> adjacency(nblock);
+	for (uint i = 0; i < nblock; i++) adjacency[i].push_back(i);
+	for (uint i = 0; i + 1 < pattern.size(); i += 2)
+	{
+		uint a = pattern[i], b = pattern[i + 1];
+		if (a == (uint)-1 || b == (uint)-1 || a == b) continue;
+		adjacency[a].push_back(b);
+		adjacency[b].push_back(a);
+	}
+
+	//Compressed rows
+	_row.resize(nblock + 1);
+	_row[0] = 0;
+	_column.clear();
+	_offset.clear();
+	uint nvalue = 0;
+	for (uint i = 0; i < nblock; i++)
+	{
+		std::sort(adjacency[i].begin(), adjacency[i].end());
+		adjacency[i].erase(std::unique(adjacency[i].begin(), adjacency[i].end()), adjacency[i].end());
+		_row[i + 1] = _row[i] + adjacency[i].size();
+		for (uint j = 0; j < adjacency[i].size(); j++)
+		{
+			_column.push_back(adjacency[i][j]);
+			_offset.push_back(nvalue);
+			nvalue += size[i] * size[adjacency[i][j]];
+		}
+	}
+	_value.assign(nvalue, 0.0);
+	_create_envelope();
+}
+
+void p6::BlockSparseMatrix::set_zero() noexcept
+{
+	std::fill(_value.begin(), _value.end(), 0.0);
+	_factorized = false;
+}
+
+p6::real &p6::BlockSparseMatrix::at(uint row, uint column) noexcept
+{
+	return _value[find(row, column)];
+}
+
+p6::uint p6::BlockSparseMatrix::find(uint row, uint column) const noexcept
+{
+	uint block_row = _block[row], block_column = _block[column];
+	auto begin = _column.begin() + _row[block_row], end = _column.begin() + _row[block_row + 1];
+	auto found = std::lower_bound(begin, end, block_column);
+	assert(found != end && *found == block_column);
+	uint stored = found - _column.begin();
+	return _offset[stored] + (row - _start[block_row]) * _size[block_column] + (column - _start[block_column]);
+}
+
+p6::real &p6::BlockSparseMatrix::value(uint offset) noexcept
+{
+	return _value[offset];
+}
+
+p6::real p6::BlockSparseMatrix::value(uint offset) const noexcept
+{
+	return _value[offset];
+}
+
+void p6::BlockSparseMatrix::get_values(std::vector<real> *value) const
+{
+	*value = _value;
+}
+
+void p6::BlockSparseMatrix::set_values(const std::vector<real> *value) noexcept
+{
+	assert(value->size() == _value.size());
+	std::copy(value->begin(), value->end(), _value.begin());
+	_factorized = false;
+}
+
+p6::uint p6::BlockSparseMatrix::get_size() const noexcept
+{
+	return _block.size();
+}
+
+p6::uint p6::BlockSparseMatrix::get_block_count() const noexcept
+{
+	return _size.size();
+}
+
+p6::uint p6::BlockSparseMatrix::get_stored_block_count() const noexcept
+{
+	return _column.size();
+}
+
+p6::uint p6::BlockSparseMatrix::get_block_size(uint block) const noexcept
+{
+	return _size[block];
+}
+
+void p6::BlockSparseMatrix::get_block_pattern(std::vector<uint> *pattern) const
+{
+	for (uint i = 0; i < _size.size(); i++)
+	{
+		for (uint j = _row[i]; j < _row[i + 1]; j++)
+		{
+			if (_column[j] == i) continue;
+			pattern->push_back(i);
+			pattern->push_back(_column[j]);
+		}
+	}
+}
+
+p6::uint p6::BlockSparseMatrix::get_stored_value_count() const noexcept
+{
+	return _value.size();
+}
+
+p6::uint p6::BlockSparseMatrix::get_envelope_size() const noexcept
+{
+	return _envelope.empty() ? 0 : _envelope.back();
+}
+
+p6::real p6::BlockSparseMatrix::get_factorization_cost() const noexcept
+{
+	//Every entry of row of L and column of U is a dot product over the envelope before it
+	real cost = 0.0;
+	for (uint i = 0; i < _first.size(); i++) cost += sqr((real)(i - _first[i]));
+	return cost;
+}
+
+void p6::BlockSparseMatrix::get_entries(std::vector<uint> *row, std::vector<uint> *column, std::vector<real> *value) const
+{
+	for (uint i = 0; i < _size.size(); i++)
+	{
+		for (uint j = _row[i]; j < _row[i + 1]; j++)
+		{
+			uint block_column = _column[j];
+			const real *block = &_value[_offset[j]];
+			for (uint r = 0; r < _size[i]; r++)
+			{
+				for (uint c = 0; c < _size[block_column]; c++)
+				{
+					row->push_back(_start[i] + r);
+					column->push_back(_start[block_column] + c);
+					value->push_back(block[r * _size[block_column] + c]);
+				}
+			}
+		}
+	}
+}
+
+void p6::BlockSparseMatrix::multiply(const Vector *x, Vector *y) const noexcept
+{
+	y->resize(get_size());
+	for (uint i = 0; i < _size.size(); i++)
+	{
+		real sum[2] = { 0.0, 0.0 };
+		for (uint j = _row[i]; j < _row[i + 1]; j++)
+		{
+			uint block_column = _column[j];
+			const real *block = &_value[_offset[j]];
+			const real *xb = x->data() + _start[block_column];
+			for (uint r = 0; r < _size[i]; r++)
+			{
+				for (uint c = 0; c < _size[block_column]; c++) sum[r] += block[r * _size[block_column] + c] * xb[c];
+			}
+		}
+		for (uint r = 0; r < _size[i]; r++) (*y)(_start[i] + r) = sum[r];
+	}
+}
+
+void p6::BlockSparseMatrix::to_dense(Matrix *dense) const noexcept
+{
+	dense->resize(get_size(), get_size());
+	dense->setZero();
+	for (uint i = 0; i < _size.size(); i++)
+	{
+		for (uint j = _row[i]; j < _row[i + 1]; j++)
+		{
+			uint block_column = _column[j];
+			const real *block = &_value[_offset[j]];
+			for (uint r = 0; r < _size[i]; r++)
+			{
+				for (uint c = 0; c < _size[block_column]; c++) (*dense)(_start[i] + r, _start[block_column] + c) = block[r * _size[block_column] + c];
+			}
+		}
+	}
+}
+
+void p6::BlockSparseMatrix::equilibrate(Vector *row_scale, Vector *column_scale) noexcept
+{
+	//Ruiz equilibration, scales are powers of two so scaling does not round
+	uint n = get_size();
+	row_scale->setOnes(n);
+	column_scale->setOnes(n);
+	std::vector<real> row_max(n), column_max(n), row_factor(n), column_factor(n);
+	for (uint iteration = 0; iteration < 10; iteration++)
+	{
+		std::fill(row_max.begin(), row_max.end(), 0.0);
+		std::fill(column_max.begin(), column_max.end(), 0.0);
+		for (uint i = 0; i < _size.size(); i++)
+		{
+			for (uint j = _row[i]; j < _row[i + 1]; j++)
+			{
+				uint block_column = _column[j];
+				const real *block = &_value[_offset[j]];
+				for (uint r = 0; r < _size[i]; r++)
+				{
+					for (uint c = 0; c < _size[block_column]; c++)
+					{
+						real value = abs(block[r * _size[block_column] + c]);
+						row_max[_start[i] + r] = std::max(row_max[_start[i] + r], value);
+						column_max[_start[block_column] + c] = std::max(column_max[_start[block_column] + c], value);
+					}
+				}
+			}
+		}
+
+		bool equilibrated = true;
+		for (uint i = 0; i < n; i++)
+		{
+			int exponent;
+			row_factor[i] = 1.0;
+			if (row_max[i] > 0.0) { frexp(row_max[i], &exponent); row_factor[i] = ldexp(1.0, -exponent / 2); }
+			column_factor[i] = 1.0;
+			if (column_max[i] > 0.0) { frexp(column_max[i], &exponent); column_factor[i] = ldexp(1.0, -exponent / 2); }
+			if (row_factor[i] != 1.0 || column_factor[i] != 1.0) equilibrated = false;
+			(*row_scale)(i) *= row_factor[i];
+			(*column_scale)(i) *= column_factor[i];
+		}
+		if (equilibrated) break;
+
+		for (uint i = 0; i < _size.size(); i++)
+		{
+			for (uint j = _row[i]; j < _row[i + 1]; j++)
+			{
+				uint block_column = _column[j];
+				real *block = &_value[_offset[j]];
+				for (uint r = 0; r < _size[i]; r++)
+				{
+					for (uint c = 0; c < _size[block_column]; c++) block[r * _size[block_column] + c] *= row_factor[_start[i] + r] * column_factor[_start[block_column] + c];
+				}
+			}
+		}
+	}
+	_factorized = false;
+}
+
+template <class T> bool p6::BlockSparseMatrix::_factorize(uint start, std::vector<T> *lower, std::vector<T> *upper, std::vector<T> *diagonal) noexcept
+{
+	//Scattering values to envelope, rows of L and columns of U before start are kept
+	uint n = get_size();
+	lower->resize(_envelope[n]);
+	upper->resize(_envelope[n]);
+	diagonal->resize(n);
+	std::fill(lower->begin() + _envelope[start], lower->end(), (T)0);
+	std::fill(upper->begin() + _envelope[start], upper->end(), (T)0);
+	std::fill(diagonal->begin() + start, diagonal->end(), (T)0);
+	real scale = 0.0;
+	for (uint i = 0; i < _size.size(); i++)
+	{
+		for (uint j = _row[i]; j < _row[i + 1]; j++)
+		{
+			uint block_column = _column[j];
+			const real *block = &_value[_offset[j]];
+			for (uint r = 0; r < _size[i]; r++)
+			{
+				for (uint c = 0; c < _size[block_column]; c++)
+				{
+					real value = block[r * _size[block_column] + c];
+					uint row = _position[_start[i] + r], column = _position[_start[block_column] + c];
+					scale = std::max(scale, abs(value));
+					if (std::max(row, column) < start) continue;
+					if (row == column) (*diagonal)[row] = (T)value;
+					else if (row > column) (*lower)[_envelope[row] + column - _first[row]] = (T)value;
+					else (*upper)[_envelope[column] + row - _first[column]] = (T)value;
+				}
+			}
+		}
+	}
+
+	//Doolittle factorization, rows of L and columns of U are contiguous
+	const real tolerance = 100.0 * std::numeric_limits<T>::epsilon() * scale;
+	for (uint k = start; k < n; k++)
+	{
+		uint upper_k = _envelope[k] - _first[k];
+		uint lower_k = _envelope[k] - _first[k];
+
+		//Column k of U
+		for (uint i = _first[k]; i < k; i++)
+		{
+			uint lower_i = _envelope[i] - _first[i];
+			T sum = 0;
+			for (uint p = std::max(_first[i], _first[k]); p < i; p++) sum += (*lower)[lower_i + p] * (*upper)[upper_k + p];
+			(*upper)[upper_k + i] -= sum;
+		}
+
+		//Row k of L
+		for (uint j = _first[k]; j < k; j++)
+		{
+			uint upper_j = _envelope[j] - _first[j];
+			T sum = 0;
+			for (uint p = std::max(_first[k], _first[j]); p < j; p++) sum += (*lower)[lower_k + p] * (*upper)[upper_j + p];
+			(*lower)[lower_k + j] = ((*lower)[lower_k + j] - sum) / (*diagonal)[j];
+		}
+
+		//Pivot
+		T sum = 0;
+		for (uint p = _first[k]; p < k; p++) sum += (*lower)[lower_k + p] * (*upper)[upper_k + p];
+		(*diagonal)[k] -= sum;
+		if (!(abs((real)(*diagonal)[k]) > tolerance)) return false;
+	}
+	return true;
+}
+
+template <class T> void p6::BlockSparseMatrix::_solve(const std::vector<T> *lower, const std::vector<T> *upper, const std::vector<T> *diagonal, const Vector *b, Vector *x) const noexcept
+{
+	//Upper is null for symmetric factorization, U = D * L^T then
+	uint n = get_size();
+	std::vector<T> y(n);
+	for (uint k = 0; k < n; k++) y[k] = (T)(*b)(_permutation[k]);
+
+	//Forward substitution with rows of L
+	for (uint k = 0; k < n; k++)
+	{
+		uint lower_k = _envelope[k] - _first[k];
+		T sum = 0;
+		for (uint p = _first[k]; p < k; p++) sum += (*lower)[lower_k + p] * y[p];
+		y[k] -= sum;
+	}
+
+	//Backward substitution with columns of U
+	if (upper == nullptr)
+	{
+		for (uint k = 0; k < n; k++) y[k] /= (*diagonal)[k];
+		for (uint k = n - 1; k != (uint)-1; k--)
+		{
+			uint lower_k = _envelope[k] - _first[k];
+			for (uint p = _first[k]; p < k; p++) y[p] -= (*lower)[lower_k + p] * y[k];
+		}
+	}
+	else for (uint k = n - 1; k != (uint)-1; k--)
+	{
+		uint upper_k = _envelope[k] - _first[k];
+		y[k] /= (*diagonal)[k];
+		for (uint p = _first[k]; p < k; p++) y[p] -= (*upper)[upper_k + p] * y[k];
+	}
+
+	x->resize(n);
+	for (uint k = 0; k < n; k++) (*x)(_permutation[k]) = (real)y[k];
+}
+
+bool p6::BlockSparseMatrix::factorize(bool single) noexcept
+{
+	//Only trailing part is refactorized if leading submatrix did not change since last factorization in the same precision
+	uint start = (_reusable && _single == single && !_symmetric) ? _get_changed_start() : 0;
+	_single = single;
+	_symmetric = false;
+	_factorization_start = start;
+	if (start == get_size()) _factorized = true;
+	else if (single) _factorized = _factorize(start, &_lower_single, &_upper_single, &_diagonal_single);
+	else _factorized = _factorize(start, &_lower, &_upper, &_diagonal);
+	_reusable = _factorized;
+	if (_factorized) _factorized_value = _value;
+	return _factorized;
+}
+
+p6::uint p6::BlockSparseMatrix::get_factorization_start() const noexcept
+{
+	return _factorization_start;
+}
+
+bool p6::BlockSparseMatrix::factorize_symmetric() noexcept
+{
+	return _factorize_symmetric(100.0 * std::numeric_limits<real>::epsilon(), nullptr);
+}
+
+bool p6::BlockSparseMatrix::factorize_semidefinite(real tolerance, std::vector<uint> *dependent) noexcept
+{
+	dependent->clear();
+	_factorize_symmetric(tolerance, dependent);
+	std::sort(dependent->begin(), dependent->end());
+	return dependent->empty();
+}
+
+bool p6::BlockSparseMatrix::_factorize_symmetric(real tolerance, std::vector<uint> *dependent) noexcept
+{
+	//Scattering lower triangle to envelope
+	uint n = get_size();
+	_lower.assign(_envelope[n], 0.0);
+	_diagonal.assign(n, 0.0);
+	real scale = 0.0;
+	for (uint i = 0; i < _size.size(); i++)
+	{
+		for (uint j = _row[i]; j < _row[i + 1]; j++)
+		{
+			uint block_column = _column[j];
+			const real *block = &_value[_offset[j]];
+			for (uint r = 0; r < _size[i]; r++)
+			{
+				for (uint c = 0; c < _size[block_column]; c++)
+				{
+					real value = block[r * _size[block_column] + c];
+					uint row = _position[_start[i] + r], column = _position[_start[block_column] + c];
+					scale = std::max(scale, abs(value));
+					if (row == column) _diagonal[row] = value;
+					else if (row > column) _lower[_envelope[row] + column - _first[row]] = value;
+				}
+			}
+		}
+	}
+
+	//Row-oriented L * D * L^T factorization
+	_single = false;
+	_symmetric = true;
+	_reusable = false;
+	_factorized = false;
+	_tolerance = tolerance * scale;
+	std::vector<bool> removed(dependent != nullptr ? n : 0, false);
+	for (uint k = 0; k < n; k++)
+	{
+		uint lower_k = _envelope[k] - _first[k];
+		for (uint j = _first[k]; j < k; j++)
+		{
+			//Removed variable has unit pivot and no coupling
+			if (dependent != nullptr && removed[j]) { _lower[lower_k + j] = 0.0; continue; }
+			uint lower_j = _envelope[j] - _first[j];
+			real sum = 0.0;
+			for (uint p = std::max(_first[k], _first[j]); p < j; p++) sum += _lower[lower_k + p] * _diagonal[p] * _lower[lower_j + p];
+			_lower[lower_k + j] = (_lower[lower_k + j] - sum) / _diagonal[j];
+		}
+		real sum = 0.0;
+		for (uint p = _first[k]; p < k; p++) sum += sqr(_lower[lower_k + p]) * _diagonal[p];
+		_diagonal[k] -= sum;
+		if (_diagonal[k] > _tolerance) continue;
+		if (dependent == nullptr) return false;
+		dependent->push_back(_permutation[k]);
+		removed[k] = true;
+		_diagonal[k] = 1.0;
+	}
+	_factorized = true;
+	return true;
+}
+
+bool p6::BlockSparseMatrix::update(const std::vector<uint> *index, const std::vector<real> *value, real sigma) noexcept
+{
+	assert(_factorized && _symmetric);
+	assert(index->size() == value->size());
+	for (uint i = 0; i < index->size(); i++)
+	{
+		for (uint j = 0; j < index->size(); j++) at(index->at(i), index->at(j)) += sigma * value->at(i) * value->at(j);
+	}
+
+	//Rank-one update of L * D * L^T, only columns reached by non-zeros of w are touched
+	uint n = get_size();
+	std::vector<real> w(n, 0.0);
+	uint start = n;
+	for (uint i = 0; i < index->size(); i++)
+	{
+		w[_position[index->at(i)]] += value->at(i);
+		start = std::min(start, _position[index->at(i)]);
+	}
+	real alpha = sigma;
+	for (uint j = start; j < n; j++)
+	{
+		real p = w[j];
+		if (p == 0.0) continue;
+		real diagonal = _diagonal[j] + alpha * sqr(p);
+		if (!(diagonal > _tolerance)) { _factorized = false; return false; }
+		real beta = p * alpha / diagonal;
+		alpha *= _diagonal[j] / diagonal;
+		_diagonal[j] = diagonal;
+		for (uint i = j + 1; i < _column_end[j]; i++)
+		{
+			if (_first[i] > j) continue;
+			real *l = &_lower[_envelope[i] + j - _first[i]];
+			w[i] -= p * *l;
+			*l += beta * w[i];
+		}
+	}
+	return true;
+}
+
+void p6::BlockSparseMatrix::solve(const Vector *b, Vector *x) const noexcept
+{
+	assert(_factorized);
+	if (_symmetric) _solve<real>(&_lower, nullptr, &_diagonal, b, x);
+	else if (_single) _solve(&_lower_single, &_upper_single, &_diagonal_single, b, x);
+	else _solve(&_lower, &_upper, &_diagonal, b, x);
+}
+
+void p6::BlockSparseMatrix::solve(const Matrix *b, Matrix *x) const noexcept
+{
+	//Right-hand sides are stored together, so every factor entry is read once for all of them
+	assert(_factorized && !_single);
+	uint n = get_size(), m = b->cols();
+	std::vector<real> y(n * m);
+	for (uint k = 0; k < n; k++)
+	{
+		for (uint c = 0; c < m; c++) y[k * m + c] = (*b)(_permutation[k], c);
+	}
+
+	//Forward substitution with rows of L
+	for (uint k = 0; k < n; k++)
+	{
+		uint lower_k = _envelope[k] - _first[k];
+		for (uint p = _first[k]; p < k; p++)
+		{
+			real l = _lower[lower_k + p];
+			if (l == 0.0) continue;
+			for (uint c = 0; c < m; c++) y[k * m + c] -= l * y[p * m + c];
+		}
+	}
+
+	//Backward substitution with columns of U, U = D * L^T for symmetric factorization
+	if (_symmetric)
+	{
+		for (uint k = 0; k < n; k++)
+		{
+			for (uint c = 0; c < m; c++) y[k * m + c] /= _diagonal[k];
+		}
+	}
+	for (uint k = n - 1; k != (uint)-1; k--)
+	{
+		uint offset_k = _envelope[k] - _first[k];
+		if (!_symmetric)
+		{
+			for (uint c = 0; c < m; c++) y[k * m + c] /= _diagonal[k];
+		}
+		for (uint p = _first[k]; p < k; p++)
+		{
+			real u = _symmetric ? _lower[offset_k + p] : _upper[offset_k + p];
+			if (u == 0.0) continue;
+			for (uint c = 0; c < m; c++) y[p * m + c] -= u * y[k * m + c];
+		}
+	}
+
+	x->resize(n, m);
+	for (uint k = 0; k < n; k++)
+	{
+		for (uint c = 0; c < m; c++) (*x)(_permutation[k], c) = y[k * m + c];
+	}
+}
+
+void p6::BlockSparseMatrix::solve_transposed(const Vector *b, Vector *x) const noexcept
+{
+	assert(_factorized && !_single);
+	if (_symmetric) { solve(b, x); return; }
+	uint n = get_size();
+	std::vector<real> y(n);
+	for (uint k = 0; k < n; k++) y[k] = (*b)(_permutation[k]);
+
+	//Forward substitution with columns of U as rows of U^T
+	for (uint k = 0; k < n; k++)
+	{
+		uint upper_k = _envelope[k] - _first[k];
+		real sum = 0.0;
+		for (uint p = _first[k]; p < k; p++) sum += _upper[upper_k + p] * y[p];
+		y[k] = (y[k] - sum) / _diagonal[k];
+	}
+
+	//Backward substitution with rows of L as columns of L^T
+	for (uint k = n - 1; k != (uint)-1; k--)
+	{
+		uint lower_k = _envelope[k] - _first[k];
+		for (uint p = _first[k]; p < k; p++) y[p] -= _lower[lower_k + p] * y[k];
+	}
+
+	x->resize(n);
+	for (uint k = 0; k < n; k++) (*x)(_permutation[k]) = y[k];
+}
+
+bool p6::BlockSparseMatrix::refine(const Vector *b, Vector *x) const noexcept
+{
+	assert(_factorized);
+	solve(b, x);
+	real bnorm = b->norm();
+	if (bnorm == 0.0) return true;
+
+	//Residual is computed with double precision matrix, correction with factorization
+	Vector residual, correction;
+	real last_norm = std::numeric_limits<real>::infinity();
+	for (uint iteration = 0; iteration < 20; iteration++)
+	{
+		multiply(x, &residual);
+		residual = *b - residual;
+		real norm = residual.norm();
+		if (norm <= 1e-14 * bnorm) return true;
+		if (norm > 0.5 * last_norm) return norm <= 1e-10 * bnorm;
+		last_norm = norm;
+		solve(&residual, &correction);
+		*x += correction;
+	}
+	return false;
+}
@@ -12,16 +12,15 @@
 #include "../header/p6_linear_material.hpp"
 #include "../header/p6_nonlinear_material.hpp"
 #include "../header/p6_file.hpp"
+#include "../header/p6_math.hpp"
+#include "../header/p6_dispatcher.hpp"
+#include "../header/p6_trace.hpp"
 #include <cassert>
-#include <Eigen>
-
-class p6::Construction::Vector : public Eigen::Vector<p6::real, Eigen::Dynamic>
-{
-public:
-	using Eigen::Vector<p6::real, Eigen::Dynamic>::Vector;
-};
-
-class p6::Construction::Matrix : public Eigen::Matrix<p6::real, Eigen::Dynamic, Eigen::Dynamic> {};
+#include <ostream>
+#include <stdexcept>
+#include <cstring>
+#include <limits>
+#include <algorithm>
 
 p6::uint p6::Construction::create_node() noexcept
 {
@@ -30,7 +29,6 @@ p6::uint p6::Construction::create_node() noexcept
 	node.freedom = 0;
 	node.coord = Coord(0.0, 0.0);
 	node.angle = 0.0;
-	node.coord_simulated = Coord(0.0, 0.0);
 	_node.push_back(node);
 	return _node.size() - 1;
 }
@@ -55,6 +53,18 @@ void p6::Construction::delete_node(uint node) noexcept
 		if (_force[i].node == node) _force.erase(_force.begin() + i);
 		else if (_force[i].node > node) _force[i].node--;
 	}
+	for (uint i = _superelement.size() - 1; i != (uint)-1; i--)
+	{
+		std::vector<uint> *boundary = &_superelement[i].node;
+		if (std::find(boundary->begin(), boundary->end(), node) != boundary->end())
+		{
+			_superelement.erase(_superelement.begin() + i);
+		}
+		else for (uint j = 0; j < boundary->size(); j++)
+		{
+			if (boundary->at(j) > node) boundary->at(j)--;
+		}
+	}
 	_node.erase(_node.begin() + node);
 }
 
@@ -91,7 +101,7 @@ p6::uint p6::Construction::get_node_count() const noexcept
 
 p6::Coord p6::Construction::get_node_coord(uint node) const noexcept
 {
-	return _simulation ? _node[node].coord_simulated : _node[node].coord;
+	return _simulation ? _solution.get_node_coord(node) : _node[node].coord;
 }
 
 unsigned char p6::Construction::get_node_freedom(uint node) const noexcept
@@ -169,26 +179,20 @@ void p6::Construction::get_stick_node(uint stick, uint node[2]) const noexcept
 
 p6::real p6::Construction::get_stick_length(uint stick) const noexcept
 {
-	const Node *node[2] = { &_node[_stick[stick].node[0]], &_node[_stick[stick].node[1]] };
-	return _simulation ?
-		node[0]->coord_simulated.distance(node[1]->coord_simulated) :
-		node[0]->coord.distance(node[1]->coord);
+	const uint *node = _stick[stick].node;
+	return get_node_coord(node[0]).distance(get_node_coord(node[1]));
 }
 
 p6::real p6::Construction::get_stick_strain(uint stick) const noexcept
 {
 	assert(_simulation);
-	const Node *node[2] = { &_node[_stick[stick].node[0]], &_node[_stick[stick].node[1]] };
-	return (
-		node[0]->coord_simulated.distance(node[1]->coord_simulated) /
-		node[0]->coord.distance(node[1]->coord)
-		) - 1.0;
+	return _solution.get_stick_strain(stick);
 }
 
 p6::real p6::Construction::get_stick_force(uint stick) const noexcept
 {
 	assert(_simulation);
-	return _stick[stick].area * _material[_stick[stick].material]->stress(get_stick_strain(stick));
+	return _solution.get_stick_force(stick);
 }
 
 p6::uint p6::Construction::create_force(uint node) noexcept
@@ -306,10 +310,13 @@ p6::String p6::Construction::get_material_formula(uint material) const noexcept
 
 void p6::Construction::save(const String filepath) const
 {
+	TraceScope trace("Construction::save");
+
 	//Open file
 	OutputFile file(filepath);
 	if (!file.ok()) throw std::runtime_error("File cannot be opened for write");
 	Header header;
+	if (!_superelement.empty()) header.signature[6] = '1';
 	header.node = _node.size();
 	header.stick = _stick.size();
 	header.force = _force.size();
@@ -319,7 +326,7 @@ void p6::Construction::save(const String filepath) const
 	//Nodes
 	for (uint i = 0; i < _node.size(); i++)
 	{
-		file.write(&_node[i], sizeof(StaticNode));
+		file.write(&_node[i], sizeof(Node));
 	}
 
 	//Sticks
@@ -362,22 +369,29 @@ void p6::Construction::save(const String filepath) const
 			file.write(formula.data(), len);
 		}
 	}
+
+	//Superelements
+	if (!_superelement.empty()) _write_superelements(&file);
 }
 
 void p6::Construction::load(const String filepath)
 {
+	TraceScope trace("Construction::load");
+
 	//Open file
 	InputFile file(filepath);
 	if (!file.ok()) throw std::runtime_error("File cannot be opened for read");
 	Header header, sample;
 	file.read(&header, sizeof(Header));
-	if (memcmp(header.signature, sample.signature, 8) != 0) throw ("Invalid file format");
+	if (memcmp(header.signature, sample.signature, 6) != 0
+		|| (header.signature[6] != '0' && header.signature[6] != '1')
+		|| header.signature[7] != '\0') throw std::runtime_error("Invalid file format");
 	
 	//Nodes
 	_node.resize(header.node);
 	for (uint i = 0; i < _node.size(); i++)
 	{
-		file.read(&_node[i], sizeof(StaticNode));
+		file.read(&_node[i], sizeof(Node));
 	}
 
 	//Sticks
@@ -425,16 +439,24 @@ void p6::Construction::load(const String filepath)
 			_material[i] = new NonlinearMaterial(name, formula);
 		}
 	}
+
+	//Superelements
+	_superelement.clear();
+	if (header.signature[6] == '1') _read_superelements(&file, 0);
 }
 
 void p6::Construction::import(const String filepath)
 {
+	TraceScope trace("Construction::import");
+
 	//Open file
 	InputFile file(filepath);
 	if (!file.ok()) throw std::runtime_error("File cannot be opened for read");
 	Header header, sample;
 	file.read(&header, sizeof(Header));
-	if (memcmp(header.signature, sample.signature, 8) != 0) throw ("Invalid file format");
+	if (memcmp(header.signature, sample.signature, 6) != 0
+		|| (header.signature[6] != '0' && header.signature[6] != '1')
+		|| header.signature[7] != '\0') throw std::runtime_error("Invalid file format");
 
 	uint old_node_size = _node.size();
 	uint old_stick_size = _stick.size();
@@ -445,7 +467,7 @@ void p6::Construction::import(const String filepath)
 	_node.resize(old_node_size + header.node);
 	for (uint i = old_node_size; i < _node.size(); i++)
 	{
-		file.read(&_node[i], sizeof(StaticNode));
+		file.read(&_node[i], sizeof(Node));
 	}
 
 	//Sticks
@@ -516,517 +538,301 @@ void p6::Construction::import(const String filepath)
 		}
 
 		//Correcting sticks
-		for (uint i = old_stick_size; i < _stick.size(); i++)
+		for (uint j = old_stick_size; j < _stick.size(); j++)
 		{
-			if (_stick[i].material == old_material_size + i) _stick[i].material = existing_material;
+			if (_stick[j].material == old_material_size + i) _stick[j].material = existing_material;
 		}
 	}
-}
-
-p6::uint p6::Construction::_node_equation_fx(uint free2d) const noexcept
-{
-	assert(free2d < _nfree2d);
-	return 2 * free2d;
-}
-
-p6::uint p6::Construction::_node_equation_fy(uint free2d) const noexcept
-{
-	assert(free2d < _nfree2d);
-	return 2 * free2d + 1;
-}
-
-p6::uint p6::Construction::_node_equation_fr(uint free1d) const noexcept
-{
-	assert(free1d < _nfree1d);
-	return 2 * _nfree2d + free1d;
-}
-
-p6::uint p6::Construction::_equation_number() const noexcept
-{
-	return 2 * _nfree2d + _nfree1d;
-}
-
-p6::uint p6::Construction::_node_variable_x(uint free2d) const noexcept
-{
-	assert(free2d < _nfree2d);
-	return 2 * free2d;
-}
-
-p6::uint p6::Construction::_node_variable_y(uint free2d) const noexcept
-{
-	assert(free2d < _nfree2d);
-	return 2 * free2d + 1;
-}
-
-p6::uint p6::Construction::_node_variable_r(uint free1d) const noexcept
-{
-	assert(free1d < _nfree1d);
-	return 2 * _nfree2d + free1d;
-}
-
-p6::uint p6::Construction::_variable_number() const noexcept
-{
-	return 2 * _nfree2d + _nfree1d;
-}
-
-void p6::Construction::_check_materials_specified() const
-{
-	for (uint i = 0; i < _stick.size(); i++)
-	{
-		assert(_stick[i].material < _material.size() || _stick[i].material == (uint)-1);
-		if (_stick[i].material == (uint)-1) throw std::runtime_error("Material is not specified");
-	}
-}
 
-void p6::Construction::_create_map(std::vector<uint> *node_to_free) noexcept
-{
-	_nfree2d = 0;
-	_nfree1d = 0;
-	node_to_free->resize(_node.size(), (uint)-1);
-	for (uint i = 0; i < _node.size(); i++)
-	{
-		if (_node[i].freedom == 1)
+	//Superelements
+	if (header.signature[6] == '1') _read_superelements(&file, old_node_size);
+}
+
+void p6::Construction::_write_superelements(OutputFile *file) const
+{
+	//Blocks used by superelements
+	std::vector<const Block*> blocks;
+	for (uint i = 0; i < _superelement.size(); i++)
+	{
+		if (std::find(blocks.begin(), blocks.end(), _superelement[i].block.get()) == blocks.end())
+			blocks.push_back(_superelement[i].block.get());
+	}
+	uint len = blocks.size();
+	file->write(&len, sizeof(uint));
+	for (uint i = 0; i < blocks.size(); i++)
+	{
+		len = blocks[i]->filepath.size();
+		file->write(&len, sizeof(uint));
+		file->write(blocks[i]->filepath.data(), len);
+		file->write(&blocks[i]->condensation, sizeof(Condensation));
+		len = blocks[i]->coord.size();
+		file->write(&len, sizeof(uint));
+		file->write(blocks[i]->coord.data(), len * sizeof(Coord));
+		file->write(blocks[i]->tangent.data(), 4 * len * len * sizeof(real));
+		file->write(blocks[i]->force.data(), 2 * len * sizeof(real));
+	}
+
+	//Superelements
+	len = _superelement.size();
+	file->write(&len, sizeof(uint));
+	for (uint i = 0; i < _superelement.size(); i++)
+	{
+		uint block = std::find(blocks.begin(), blocks.end(), _superelement[i].block.get()) - blocks.begin();
+		file->write(&block, sizeof(uint));
+		file->write(_superelement[i].node.data(), _superelement[i].node.size() * sizeof(uint));
+	}
+}
+
+void p6::Construction::_read_superelements(InputFile *file, uint node_offset)
+{
+	//Every length is checked against rest of file before memory is allocated
+	uint position = file->position(), end = file->size();
+	if (position > end) throw std::runtime_error("Invalid file format");
+	uint available = end - position;
+	auto consume = [&available](uint count, uint size)
+	{
+		if (count > available / size) throw std::runtime_error("Invalid file format");
+		available -= count * size;
+	};
+
+	//Blocks, cached ones are shared if they have the same data
+	uint len;
+	consume(1, sizeof(uint));
+	file->read(&len, sizeof(uint));
+	if (len > available / sizeof(uint)) throw std::runtime_error("Invalid file format");
+	std::vector<std::shared_ptr<const Block>> blocks(len);
+	for (uint i = 0; i < blocks.size(); i++)
+	{
+		std::shared_ptr<Block> block = std::make_shared<Block>();
+		consume(1, sizeof(uint));
+		file->read(&len, sizeof(uint));
+		consume(len, 1);
+		block->filepath.resize(len);
+		file->read(&block->filepath[0], len);
+		consume(1, sizeof(Condensation) + sizeof(uint));
+		file->read(&block->condensation, sizeof(Condensation));
+		file->read(&len, sizeof(uint));
+		consume(len, sizeof(Coord));
+		consume(4 * len * len, sizeof(real));
+		consume(2 * len, sizeof(real));
+		block->coord.resize(len);
+		block->tangent.resize(4 * len * len);
+		block->force.resize(2 * len);
+		file->read(block->coord.data(), len * sizeof(Coord));
+		file->read(block->tangent.data(), 4 * len * len * sizeof(real));
+		file->read(block->force.data(), 2 * len * sizeof(real));
+
+		//Part file may have changed since cached block was condensed, data saved in file is preferred
+		bool cached = false;
+		for (uint j = 0; j < _block.size(); j++)
 		{
-			node_to_free->at(i) = _nfree1d;
-			_nfree1d++;
+			if (_block[j]->filepath != block->filepath || _block[j]->condensation != block->condensation) continue;
+			cached = true;
+			if (_block[j]->tangent == block->tangent && _block[j]->force == block->force && _block[j]->coord.size() == block->coord.size()
+				&& std::equal(block->coord.begin(), block->coord.end(), _block[j]->coord.begin(), [](Coord a, Coord b) { return a.x == b.x && a.y == b.y; }))
+				blocks[i] = _block[j];
 		}
-		else if (_node[i].freedom == 2)
+		if (blocks[i] == nullptr)
 		{
-			node_to_free->at(i) = _nfree2d;
-			_nfree2d++;
+			blocks[i] = block;
+			if (!cached) _block.push_back(block);
 		}
 	}
-}
 
-p6::real p6::Construction::_get_tolerance() const noexcept
-{
-	real minforce = std::numeric_limits<real>::infinity();
-	for (uint i = 0; i < _force.size(); i++)
-	{
-		real newforce = _force[i].direction.norm();
-		if (newforce < minforce) minforce = newforce;
+	//Superelements
+	consume(1, sizeof(uint));
+	file->read(&len, sizeof(uint));
+	if (len > available / sizeof(uint)) throw std::runtime_error("Invalid file format");
+	std::vector<Superelement> superelement(len);
+	for (uint i = 0; i < superelement.size(); i++)
+	{
+		uint block;
+		consume(1, sizeof(uint));
+		file->read(&block, sizeof(uint));
+		if (block >= blocks.size()) throw std::runtime_error("Invalid file format");
+		superelement[i].block = blocks[block];
+		consume(blocks[block]->coord.size(), sizeof(uint));
+		superelement[i].node.resize(blocks[block]->coord.size());
+		file->read(superelement[i].node.data(), superelement[i].node.size() * sizeof(uint));
+		for (uint j = 0; j < superelement[i].node.size(); j++)
+		{
+			if (superelement[i].node[j] >= _node.size() - node_offset) throw std::runtime_error("Invalid file format");
+			superelement[i].node[j] += node_offset;
+		}
 	}
-	return minforce / 1000.0;
+	_superelement.insert(_superelement.end(), superelement.begin(), superelement.end());
 }
 
-void p6::Construction::_create_vectors(
-	const std::vector <uint> *node_to_free,
-	Vector *s,
-	Vector *z,
-	Vector *m,
-	Matrix *d) const noexcept
+std::shared_ptr<const p6::Construction::Block> p6::Construction::_condense(const String filepath, Condensation condensation)
 {
-	s->resize(_variable_number());
-	for (uint i = 0; i < _node.size(); i++)
+	//Loading sub-assembly, it's fixed nodes become boundary nodes
+	Construction part;
+	part.load(filepath);
+	std::vector<uint> boundary;
+	for (uint i = 0; i < part._node.size(); i++)
 	{
-		if (_node[i].freedom == 1)
-		{
-			uint free1d = node_to_free->at(i);
-			(*s)(_node_variable_r(free1d)) = 0.0;
-		}
-		else if (_node[i].freedom == 2)
-		{
-			uint free2d = node_to_free->at(i);
-			(*s)(_node_variable_x(free2d)) = _node[i].coord.x;
-			(*s)(_node_variable_y(free2d)) = _node[i].coord.y;
-		}
+		if (part._node[i].freedom == 0) boundary.push_back(i);
 	}
-	z->resize(_equation_number());
-	z->setZero();
-	m->resize(_equation_number());
-	m->setZero();
-	d->resize(_equation_number(), _variable_number());
-	d->setZero();
-}
+	if (boundary.empty()) throw std::runtime_error("Superelement has no fixed nodes to be condensed to");
 
-void p6::Construction::_set_z_to_external_forces(
-	const std::vector <uint> *node_to_free,
-	Vector *z) const noexcept
-{
-	for (uint i = 0; i < _force.size(); i++)
+	//Finding reference state with fixed boundary, then releasing boundary
+	Solution reference;
+	if (condensation == Condensation::tangent) reference = part.snapshot().solve();
+	for (uint i = 0; i < boundary.size(); i++) part._node[boundary[i]].freedom = 2;
+	Snapshot snapshot = part.snapshot();
+	Vector s, z;
+	Matrix d;
+	if (condensation == Condensation::tangent) snapshot.get_state(&reference, &s);
+	else snapshot.get_initial_state(&s);
+	snapshot.get_residual(&s, &z);
+	snapshot.get_tangent(&s, &d);
+
+	//Splitting variables into boundary and interior ones
+	std::vector<bool> is_boundary(snapshot.get_variable_number(), false);
+	std::vector<uint> boundary_variable, interior_variable;
+	for (uint i = 0; i < boundary.size(); i++)
 	{
-		uint node = _force[i].node;
-		if (_node[node].freedom == 1)
-		{
-			uint free1d = node_to_free->at(node);
-			real angle = _node[node].angle;
-			(*z)(_node_variable_r(free1d)) = _force[i].direction.x * cos(angle) + _force[i].direction.y * sin(angle);
-		}
-		else if (_node[node].freedom == 2)
-		{
-			uint free2d = node_to_free->at(node);
-			(*z)(_node_variable_x(free2d)) = _force[i].direction.x;
-			(*z)(_node_variable_y(free2d)) = _force[i].direction.y;
-		}
+		uint variable[2];
+		snapshot.get_node_variable(boundary[i], variable);
+		boundary_variable.push_back(variable[0]);
+		boundary_variable.push_back(variable[1]);
+		is_boundary[variable[0]] = is_boundary[variable[1]] = true;
+	}
+	for (uint i = 0; i < is_boundary.size(); i++)
+	{
+		if (!is_boundary[i]) interior_variable.push_back(i);
+	}
+	uint nb = boundary_variable.size(), ni = interior_variable.size();
+	Matrix dbb(nb, nb), dbi(nb, ni), dib(ni, nb), dii(ni, ni);
+	Vector zb(nb), zi(ni);
+	for (uint i = 0; i < nb; i++)
+	{
+		zb(i) = z(boundary_variable[i]);
+		for (uint j = 0; j < nb; j++) dbb(i, j) = d(boundary_variable[i], boundary_variable[j]);
+		for (uint j = 0; j < ni; j++) dbi(i, j) = d(boundary_variable[i], interior_variable[j]);
+	}
+	for (uint i = 0; i < ni; i++)
+	{
+		zi(i) = z(interior_variable[i]);
+		for (uint j = 0; j < nb; j++) dib(i, j) = d(interior_variable[i], boundary_variable[j]);
+		for (uint j = 0; j < ni; j++) dii(i, j) = d(interior_variable[i], interior_variable[j]);
 	}
-}
 
-void p6::Construction::_set_d_to_zero(
-	const std::vector <uint> *node_to_free,
-	Matrix *d) const noexcept
-{
-	for (uint i = 0; i < _stick.size(); i++)
+	//Static condensation, interior is in equilibrium for any boundary displacement
+	Matrix tangent = dbb;
+	Vector force = zb;
+	if (ni > 0)
 	{
-		const uint *node = _stick[i].node;
-		for (uint j = 0; j < 2; j++)
-		{
-			//If current point is fixed on rail
-			if (_node[node[j]].freedom == 1)
-			{
-				//It sets own derivatives on own coordinates
-				uint free1d = node_to_free->at(node[j]);
-				(*d)(_node_equation_fr(free1d), _node_variable_r(free1d)) = 0.0;
-
-				//And own derivatives on coordinates of other point
-				if (_node[node[j ^ 1]].freedom == 1)
-				{
-					uint other_free1d = node_to_free->at(node[j ^ 1]);
-					(*d)(_node_equation_fr(free1d), _node_variable_r(other_free1d)) = 0.0;
-				}
-				else if (_node[node[j ^ 1]].freedom == 2)
-				{
-					uint other_free2d = node_to_free->at(node[j ^ 1]);
-					(*d)(_node_equation_fr(free1d), _node_variable_x(other_free2d)) = 0.0;
-					(*d)(_node_equation_fr(free1d), _node_variable_y(other_free2d)) = 0.0;
-				}
-			}
-			//If current point is free
-			else if (_node[node[j]].freedom == 2)
-			{
-				//It sets own derivatives on own coordinates
-				uint free2d = node_to_free->at(node[j]);
-				(*d)(_node_equation_fx(free2d), _node_variable_x(free2d)) = 0.0;
-				(*d)(_node_equation_fx(free2d), _node_variable_y(free2d)) = 0.0;
-				(*d)(_node_equation_fy(free2d), _node_variable_x(free2d)) = 0.0;
-				(*d)(_node_equation_fy(free2d), _node_variable_y(free2d)) = 0.0;
-
-				//And own derivatives on coordinates of other point
-				if (_node[node[j ^ 1]].freedom == 1)
-				{
-					uint other_free1d = node_to_free->at(node[j ^ 1]);
-					(*d)(_node_equation_fx(free2d), _node_variable_r(other_free1d)) = 0.0;
-					(*d)(_node_equation_fy(free2d), _node_variable_r(other_free1d)) = 0.0;
-				}
-				else if (_node[node[j ^ 1]].freedom == 2)
-				{
-					uint other_free2d = node_to_free->at(node[j ^ 1]);
-					(*d)(_node_equation_fx(free2d), _node_variable_x(other_free2d)) = 0.0;
-					(*d)(_node_equation_fx(free2d), _node_variable_y(other_free2d)) = 0.0;
-					(*d)(_node_equation_fy(free2d), _node_variable_x(other_free2d)) = 0.0;
-					(*d)(_node_equation_fy(free2d), _node_variable_y(other_free2d)) = 0.0;
-				}
-			}
-		}
+		Eigen::FullPivLU<Eigen::Matrix<real, Eigen::Dynamic, Eigen::Dynamic>> lu(dii);
+		if (!lu.isInvertible()) throw std::runtime_error("Superelement's interior is a mechanism");
+		tangent -= dbi * lu.solve(dib);
+		force -= dbi * lu.solve(zi);
 	}
-}
 
-p6::Coord p6::Construction::_get_delta(
-	uint stick,
-	const std::vector <uint> *node_to_free,
-	const Vector *s) const noexcept
-{
-	const uint *node = _stick[stick].node;
-	Coord coord[2];
-	for (uint i = 0; i < 2; i++)
+	std::shared_ptr<Block> block = std::make_shared<Block>();
+	block->filepath = filepath;
+	block->condensation = condensation;
+	for (uint i = 0; i < boundary.size(); i++) block->coord.push_back(part._node[boundary[i]].coord);
+	block->tangent.resize(nb * nb);
+	for (uint i = 0; i < nb; i++)
 	{
-		if (_node[node[i]].freedom == 1)
-		{
-			uint free1d = node_to_free->at(node[i]);
-			real angle = _node[node[i]].angle;
-			coord[i] = _node[node[i]].coord + Coord(cos(angle), sin(angle)) * (*s)(_node_variable_r(free1d));
-		}
-		else if (_node[node[i]].freedom == 2)
-		{
-			uint free2d = node_to_free->at(node[i]);
-			coord[i] = Coord((*s)(_node_variable_x(free2d)), (*s)(_node_variable_y(free2d)));
-		}
-		else coord[i] = _node[node[i]].coord;
+		for (uint j = 0; j < nb; j++) block->tangent[i * nb + j] = tangent(i, j);
 	}
-	return coord[1] - coord[0];
+	block->force.assign(force.data(), force.data() + nb);
+	return block;
 }
 
-void p6::Construction::_modify_z_with_stick_force(
-	uint stick,
-	const std::vector <uint> *node_to_free,
-	const Vector *s,
-	Vector *z) const noexcept
+p6::uint p6::Construction::import_superelement(const String filepath, Condensation condensation)
 {
-	const Material *material = _material[_stick[stick].material];
-	const uint *node = _stick[stick].node;
-	Coord delta = _get_delta(stick, node_to_free, s);
-	real length = delta.norm();
-	real initial_length = _node[node[0]].coord.distance(_node[node[1]].coord);
-	real force = _stick[stick].area * material->stress(length / initial_length - 1.0);
+	assert(!_simulation);
 
-	for (uint i = 0; i < 2; i++)
+	//Condensing once per file
+	std::shared_ptr<const Block> block;
+	for (uint i = 0; i < _block.size(); i++)
 	{
-		if (_node[node[i]].freedom == 1)
-		{
-			uint free1d = node_to_free->at(node[i]);
-			real sign = i == 0 ? 1.0 : -1.0;
-			(*z)(_node_variable_r(free1d)) +=
-				cos(_node[node[i]].angle) * sign * force * delta.x / length +
-				sin(_node[node[i]].angle) * sign * force * delta.y / length;
-		}
-		else if (_node[node[i]].freedom == 2)
-		{
-			uint free2d = node_to_free->at(node[i]);
-			real sign = i == 0 ? 1.0 : -1.0;
-			(*z)(_node_variable_x(free2d)) += sign * force * delta.x / length;
-			(*z)(_node_variable_y(free2d)) += sign * force * delta.y / length;
-		}
+		if (_block[i]->filepath == filepath && _block[i]->condensation == condensation) block = _block[i];
 	}
-}
-
-void p6::Construction::_modify_d_with_stick_force(
-	uint stick,
-	const std::vector <uint> *node_to_free,
-	const Vector *s,
-	Matrix *d) const noexcept
-{
-	const uint *node = _stick[stick].node;
-	const Material *material = _material[_stick[stick].material];
-	Coord delta = _get_delta(stick, node_to_free, s);
-	real length = delta.norm();
-	real initial_length = _node[node[0]].coord.distance(_node[node[1]].coord);
-	real strain = length / initial_length - 1.0;
-	real force = _stick[stick].area * material->stress(strain);
-
-	for (uint i = 0; i < 2; i++)
+	if (block == nullptr)
 	{
-		Coord deltaoi = (i == 0) ? delta : delta * (-1.0);
+		block = _condense(filepath, condensation);
+		_block.push_back(block);
+	}
 
-		//If current point is fixed on rail
-		if (_node[node[i]].freedom == 1)
-		{
-			//It sets own derivatives on own coordinates
-			uint free1d = node_to_free->at(node[i]);
-			real anglei = _node[node[i]].angle;
-			real dl_dri = (-deltaoi.x * cos(anglei) - deltaoi.y * sin(anglei)) / length;
-			real df_dri = _stick[stick].area * material->derivative(strain) * dl_dri / initial_length;
-			(*d)(_node_equation_fr(free1d), _node_variable_r(free1d)) += (
-				cos(anglei) * ((df_dri * deltaoi.x + force * (-cos(anglei))) * length - dl_dri * force * deltaoi.x) +
-				sin(anglei) * ((df_dri * deltaoi.y + force * (-sin(anglei))) * length - dl_dri * force * deltaoi.y)
-				) / sqr(length);
-
-			//And own derivatives on coordinates of other point
-			if (_node[node[i ^ 1]].freedom == 1)
-			{
-				uint other_free1d = node_to_free->at(node[i ^ 1]);
-				real angleo = _node[node[i ^ 1]].angle;
-				real dl_dro = (deltaoi.x * cos(angleo) + deltaoi.y * sin(angleo)) / length;
-				real df_dro = _stick[stick].area * material->derivative(strain) * dl_dro / initial_length;
-				(*d)(_node_equation_fr(free1d), _node_variable_r(other_free1d)) += (
-					cos(anglei) * ((df_dro * deltaoi.x + force * cos(angleo)) * length - dl_dro * force * deltaoi.x) +
-					sin(anglei) * ((df_dro * deltaoi.y + force * sin(angleo)) * length - dl_dro * force * deltaoi.y)
-					) / sqr(length);
-			}
-			else if (_node[node[i ^ 1]].freedom == 2)
-			{
-				uint other_free2d = node_to_free->at(node[i ^ 1]);
-				real dl_dxo = deltaoi.x / length;
-				real df_dxo = _stick[stick].area * material->derivative(strain) * dl_dxo / initial_length;
-				(*d)(_node_equation_fr(free1d), _node_variable_x(other_free2d)) += (
-					cos(anglei) * ((df_dxo * deltaoi.x + force * 1.0) * length - dl_dxo * force * deltaoi.x) +
-					sin(anglei) * deltaoi.y * (df_dxo * length - dl_dxo * force)
-					) / sqr(length);
-				real dl_dyo = deltaoi.y / length;
-				real df_dyo = _stick[stick].area * material->derivative(strain) * dl_dyo / initial_length;
-				(*d)(_node_equation_fr(free1d), _node_variable_y(other_free2d)) += (
-					cos(anglei) * deltaoi.x * (df_dyo * length - dl_dyo * force) +
-					sin(anglei) * ((df_dyo * deltaoi.y + force * 1.0) * length - dl_dyo * force * deltaoi.y)
-					) / sqr(length);
-			}
-		}
-		//If current point is free
-		else if (_node[node[i]].freedom == 2)
-		{
-			//It sets own derivatives on own coordinates
-			uint free2d = node_to_free->at(node[i]);
-			
-			real dl_dxi = -deltaoi.x / length;
-			real df_dxi = _stick[stick].area * material->derivative(strain) * dl_dxi / initial_length;
-			real dfxi_dxi = ((df_dxi * deltaoi.x + force * (-1.0)) * length - dl_dxi * force * deltaoi.x) / sqr(length);
-			(*d)(_node_equation_fx(free2d), _node_variable_x(free2d)) += dfxi_dxi;
-			real dl_dyi = -deltaoi.y / length;
-			real df_dyi = _stick[stick].area * material->derivative(strain) * dl_dyi / initial_length;
-			real dfxi_dyi = deltaoi.x * (df_dyi * length - dl_dyi * force) / sqr(length);
-			(*d)(_node_equation_fx(free2d), _node_variable_y(free2d)) += dfxi_dyi;
-			real dfyi_dxi = deltaoi.y * (df_dxi * length - dl_dxi * force) / sqr(length);
-			(*d)(_node_equation_fy(free2d), _node_variable_x(free2d)) += dfyi_dxi;
-			real dfyi_dyi = ((df_dyi * deltaoi.y + force * (-1.0)) * length - dl_dyi * force * deltaoi.y) / sqr(length);
-			(*d)(_node_equation_fy(free2d), _node_variable_y(free2d)) += dfyi_dyi;
-
-			//And own derivatives on coordinates of other point
-			if (_node[node[i ^ 1]].freedom == 1)
-			{
-				uint other_free1d = node_to_free->at(node[i ^ 1]);
-				real angleo = _node[node[i ^ 1]].angle;
-				real dl_dro = (deltaoi.x * cos(angleo) + deltaoi.y * sin(angleo)) / length;
-				real df_dro = _stick[stick].area * material->derivative(strain) * dl_dro / initial_length;
-				(*d)(_node_equation_fx(free2d), _node_variable_r(other_free1d)) +=
-					((df_dro * deltaoi.x + force * cos(angleo)) * length - dl_dro * force * deltaoi.x) / sqr(length);
-				(*d)(_node_equation_fy(free2d), _node_variable_r(other_free1d)) +=
-					((df_dro * deltaoi.y + force * sin(angleo)) * length - dl_dro * force * deltaoi.y) / sqr(length);
-			}
-			else if (_node[node[i ^ 1]].freedom == 2)
-			{
-				uint other_free2d = node_to_free->at(node[i ^ 1]);
-				(*d)(_node_equation_fx(free2d), _node_variable_x(other_free2d)) -= dfxi_dxi;
-				(*d)(_node_equation_fx(free2d), _node_variable_y(other_free2d)) -= dfxi_dyi;
-				(*d)(_node_equation_fy(free2d), _node_variable_x(other_free2d)) -= dfyi_dxi;
-				(*d)(_node_equation_fy(free2d), _node_variable_y(other_free2d)) -= dfyi_dyi;
-			}
-		}
+	Superelement superelement;
+	superelement.block = block;
+	for (uint i = 0; i < block->coord.size(); i++)
+	{
+		uint node = create_node();
+		set_node_coord(node, block->coord[i]);
+		set_node_freedom(node, 2);
+		superelement.node.push_back(node);
 	}
+	_superelement.push_back(superelement);
+	return _superelement.size() - 1;
 }
 
-p6::real p6::Construction::_get_residuum(const Vector *z) const noexcept
+void p6::Construction::delete_superelement(uint superelement) noexcept
 {
-	real error = 0.0;
-	for (int i = 0; i < z->rows(); i++)
-	{
-		real newabs = abs((*z)(i));
-		if (newabs > error) error = newabs;
-	}
-	return error;
+	assert(!_simulation);
+	_superelement.erase(_superelement.begin() + superelement);
 }
 
-void p6::Construction::_apply_state_vector(
-	const std::vector<uint> *node_to_free,
-	const Vector *s) noexcept
+p6::uint p6::Construction::get_superelement_count() const noexcept
 {
-	for (uint i = 0; i < _node.size(); i++)
-	{
-		if (_node[i].freedom == 1)
-		{
-			uint free1d = node_to_free->at(i);
-			real angle = _node[i].angle;
-			_node[i].coord_simulated = _node[i].coord + Coord(cos(angle), sin(angle)) * (*s)(_node_variable_r(free1d));
-		}
-		else if (_node[i].freedom == 2)
-		{
-			uint free2d = node_to_free->at(i);
-			_node[i].coord_simulated = Coord((*s)(_node_variable_x(free2d)), (*s)(_node_variable_y(free2d)));
-		}
-		else _node[i].coord_simulated = _node[i].coord;
-	}
+	return _superelement.size();
 }
 
-bool p6::Construction::_is_adequate(
-	const Vector *m,
-	const std::vector <uint> *node_to_free,
-	const Vector *s) const noexcept
+p6::uint p6::Construction::get_superelement_node_count(uint superelement) const noexcept
 {
-	for (int i = 0; i < m->rows(); i++)
-	{
-		if ((*m)(i) != (*m)(i)) return false;
-		for (uint i = 0; i < _stick.size(); i++)
-		{
-			const uint *node = _stick[i].node;
-			Coord delta = _get_delta(i, node_to_free, s);
-			real length = delta.norm();
-			for (uint j = 0; j < 2; j++)
-			{
-				if (_node[node[j]].freedom == 1)
-				{
-					uint free1d = node_to_free->at(node[j]);
-					real modification = abs((*m)(_node_equation_fr(free1d)));
-					if (modification > length * 0.01) return false;
-				}
-				else if (_node[node[j]].freedom == 2)
-				{
-					uint free2d = node_to_free->at(node[j]);
-					real modification = Coord((*m)(_node_equation_fx(free2d)), (*m)(_node_equation_fy(free2d))).norm();
-					if (modification > length * 0.01) return false;
-				}
-			}
-		}
-	}
-	return true;
+	return _superelement[superelement].node.size();
 }
 
-p6::real  p6::Construction::_get_flow_coefficient(
-	const std::vector <uint> *node_to_free,
-	const Vector *s,
-	const Vector *z) const noexcept
+p6::uint p6::Construction::get_superelement_node(uint superelement, uint index) const noexcept
 {
-	real coef = std::numeric_limits<real>::infinity();
-	for (uint i = 0; i < _stick.size(); i++)
-	{
-		const uint *node = _stick[i].node;
-		Coord delta = _get_delta(i, node_to_free, s);
-		real length = delta.norm();
-		real initial_length = _node[node[0]].coord.distance(_node[node[1]].coord);
-		real strain = length / initial_length - 1.0;
-		real df_dl = _stick[i].area * _material[_stick[i].material]->derivative(strain) / initial_length;
-		if (1.0 / df_dl < coef) coef = 1.0 / df_dl;
-
-		for (uint j = 0; j < 2; j++)
-		{
-			if (_node[node[j]].freedom == 1)
-			{
-				uint free1d = node_to_free->at(node[j]);
-				real unbalanced_force = abs((*z)(_node_equation_fr(free1d)));
-				if (length / unbalanced_force < coef) coef = length / unbalanced_force;		
-			}
-			else if (_node[node[j]].freedom == 2)
-			{
-				uint free2d = node_to_free->at(node[j]);
-				real unbalanced_force = Coord((*z)(_node_equation_fx(free2d)), (*z)(_node_equation_fy(free2d))).norm();
-				if (length / unbalanced_force < coef) coef = length / unbalanced_force;
-			}
-		}
-	}
-	return coef;
+	return _superelement[superelement].node[index];
 }
 
 void p6::Construction::simulate(bool sim)
 {
 	if (sim == _simulation) return;
 	else if (!sim) { _simulation = false; return; }
+	TraceScope trace("Construction::simulate");
+	Snapshot snapshot = this->snapshot();
+	if (_options.method == Snapshot::Method::automatic)
+	{
+		Dispatcher dispatcher(&snapshot, &_options);
+		_solution = dispatcher.solve(&snapshot);
+		if (_log != nullptr) *_log << dispatcher.message() << std::endl;
+	}
+	else _solution = snapshot.solve(&_options);
+	if (_log != nullptr && !_solution.get_warning().empty()) *_log << _solution.get_warning() << std::endl;
+	_simulation = true;
+}
 
-	//Checking if materials are specified
-	_check_materials_specified();
-
-	//Creating node-to-free map
-	std::vector<uint> node_to_free;
-	_create_map(&node_to_free);
+void p6::Construction::set_options(const Snapshot::Options *options) noexcept
+{
+	_options = *options;
+}
 
-	//Calculating tolerance
-	real tolerance = _get_tolerance();
+p6::Snapshot::Options p6::Construction::get_options() const noexcept
+{
+	return _options;
+}
 
-	//Creating vectors and matrixes
-	Vector s;	//State vector
-	Vector z;	//Should-be-zero value
-	Vector m;	//Modification of state vector
-	Matrix d;	//Derivative of should-be-zero value
-	_create_vectors(&node_to_free, &s, &z, &m, &d);
+void p6::Construction::set_log(std::ostream *log) noexcept
+{
+	_log = log;
+}
 
-	//Iterating
-	real last_error = 0.0;
-	uint not_converge_count = 0;
-	while (true)
-	{
-		_set_z_to_external_forces(&node_to_free, &z);
-		_set_d_to_zero(&node_to_free, &d);
-		for (uint i = 0; i < _stick.size(); i++)
-		{
-			_modify_z_with_stick_force(i, &node_to_free, &s, &z);
-			_modify_d_with_stick_force(i, &node_to_free, &s, &d);
-		}
-		real error = _get_residuum(&z);
-		if (error < tolerance) break;
-		else if (error < last_error) not_converge_count = 0;
-		else if (++not_converge_count == 10000) throw std::runtime_error("Simulation does not converge");
-		Eigen::HouseholderQR<Eigen::Matrix<real, Eigen::Dynamic, Eigen::Dynamic>> qr(d);
-		m = qr.solve(z);
-		if (_is_adequate(&m, &node_to_free, &s)) s -= m;
-		else s += 0.01 * _get_flow_coefficient(&node_to_free, &s, &z) * z;
-	}
-	_apply_state_vector(&node_to_free, &s);
+void p6::Construction::get_sensitivity(const Snapshot::Response *response, std::vector<real> *area, std::vector<real> *modulus) const
+{
+	assert(_simulation);
+	snapshot().get_sensitivity(&_solution, response, area, modulus);
+}
 
-	_simulation = true;
+p6::Snapshot p6::Construction::snapshot() const
+{
+	return Snapshot(this);
 }
 
 p6::Construction::~Construction()
@@ -0,0 +1,120 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#include "../header/p6_convergence_monitor.hpp"
+#include <cmath>
+
+p6::ConvergenceMonitor::ConvergenceMonitor(uint max_iterations, real max_time, uint stagnation_iterations) noexcept :
+	_max_iterations(max_iterations), _max_time(max_time), _stagnation_iterations(stagnation_iterations), _start(std::chrono::steady_clock::now())
+{}
+
+p6::ConvergenceMonitor::Diagnosis p6::ConvergenceMonitor::check(real residual) noexcept
+{
+	const uint divergence_iterations = 5;	//Iterations of growth far above smallest residual that mean divergence
+	const real divergence_factor = 1e6;		//Growth of residual above smallest one that means divergence
+	const uint oscillation_iterations = 20;	//Iterations without improvement inspected for alternating residual
+	const real improvement = 1e-3;			//Relative decrease of smallest residual that counts as improvement
+
+	_residual.push_back(residual);
+	_iterations++;
+	uint n = (uint)_residual.size();
+	if (!std::isfinite(residual)) return _diagnosis = Diagnosis::divergence;
+	if (residual < (1.0 - improvement) * _residual[_best]) _best = n - 1;
+
+	//Growth in every one of last iterations, far above smallest residual
+	if (residual > divergence_factor * _residual[_best] && n > divergence_iterations)
+	{
+		bool growing = true;
+		for (uint i = n - divergence_iterations; i < n; i++) if (!(_residual[i] > _residual[i - 1])) growing = false;
+		if (growing) return _diagnosis = Diagnosis::divergence;
+	}
+
+	//Budgets
+	if (_iterations > _max_iterations) return _diagnosis = Diagnosis::iteration_budget;
+	if (_max_time > 0.0 && std::chrono::duration<real>(std::chrono::steady_clock::now() - _start).count() > _max_time)
+		return _diagnosis = Diagnosis::time_budget;
+
+	//Direction of change flips almost every iteration while nothing improves
+	if (n - 1 - _best >= oscillation_iterations)
+	{
+		uint flips = 0;
+		for (uint i = n - oscillation_iterations + 1; i < n; i++)
+		{
+			if ((_residual[i] - _residual[i - 1]) * (_residual[i - 1] - _residual[i - 2]) < 0.0) flips++;
+		}
+		if (5 * flips >= 4 * (oscillation_iterations - 1)) return _diagnosis = Diagnosis::oscillation;
+	}
+
+	if (n - 1 - _best >= _stagnation_iterations) return _diagnosis = Diagnosis::stagnation;
+	return _diagnosis = Diagnosis::none;
+}
+
+void p6::ConvergenceMonitor::add_step(bool newton) noexcept
+{
+	_steps++;
+	if (newton) _newton_steps++;
+}
+
+void p6::ConvergenceMonitor::restart() noexcept
+{
+	_residual.clear();
+	_best = 0;
+}
+
+p6::ConvergenceMonitor::Diagnosis p6::ConvergenceMonitor::stagnate() noexcept
+{
+	return _diagnosis = Diagnosis::stagnation;
+}
+
+p6::uint p6::ConvergenceMonitor::get_iterations() const noexcept
+{
+	return _iterations;
+}
+
+p6::real p6::ConvergenceMonitor::get_acceptance_ratio() const noexcept
+{
+	return _steps == 0 ? 1.0 : (real)_newton_steps / _steps;
+}
+
+p6::ConvergenceMonitor::Diagnosis p6::ConvergenceMonitor::get_diagnosis() const noexcept
+{
+	return _diagnosis;
+}
+
+p6::String p6::ConvergenceMonitor::message() const
+{
+	String message;
+	switch (_diagnosis)
+	{
+	case Diagnosis::none: return "Simulation converges";
+	case Diagnosis::divergence: message = "Simulation diverges"; break;
+	case Diagnosis::oscillation: message = "Simulation oscillates"; break;
+	case Diagnosis::stagnation: message = "Simulation stagnates"; break;
+	case Diagnosis::iteration_budget: message = "Simulation exceeds iteration budget"; break;
+	case Diagnosis::time_budget: message = "Simulation exceeds time budget"; break;
+	}
+	message += " after " + std::to_string(_iterations) + " iterations";
+	if (!_residual.empty())
+	{
+		message += ", unbalanced force " + real_to_string(_residual.back());
+		message += ", smallest " + real_to_string(_residual[_best]);
+	}
+	message += ", " + std::to_string((uint)std::round(100.0 * get_acceptance_ratio())) + "% of Newton's modifications accepted";
+	return message;
+}
+
+p6::ConvergenceError::ConvergenceError(const ConvergenceMonitor *monitor) : std::runtime_error(monitor->message()), _diagnosis(monitor->get_diagnosis())
+{}
+
+p6::ConvergenceMonitor::Diagnosis p6::ConvergenceError::diagnosis() const noexcept
+{
+	return _diagnosis;
+}
@@ -0,0 +1,178 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#include "../header/p6_dispatcher.hpp"
+#include "../header/p6_symmetry.hpp"
+#include "../header/p6_linear_material.hpp"
+#include "../header/p6_linear_analysis.hpp"
+#include "../header/p6_convergence_monitor.hpp"
+#include "../header/p6_block_sparse_matrix.hpp"
+#include "../header/p6_domain_decomposition.hpp"
+#include "../header/p6_math.hpp"
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <thread>
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+p6::real p6::Dispatcher::_get_available_memory() noexcept
+{
+	#if defined(_WIN32)
+		MEMORYSTATUSEX status;
+		status.dwLength = sizeof(status);
+		if (GlobalMemoryStatusEx(&status)) return (real)status.ullAvailPhys;
+	#elif defined(_SC_AVPHYS_PAGES)
+		long pages = sysconf(_SC_AVPHYS_PAGES), size = sysconf(_SC_PAGESIZE);
+		if (pages > 0 && size > 0) return (real)pages * (real)size;
+	#endif
+	return std::numeric_limits<real>::infinity();
+}
+
+p6::Dispatcher::Dispatcher(const Snapshot *snapshot, const Snapshot::Options *options) : _options(*options)
+{
+	const real rate = 1e9;				//Multiply-adds per second
+	const real memory_part = 0.5;		//Part of available memory factorization may take
+	const real krylov_factor = 4.0;		//GMRES iterations per square root of number of variables
+	const real thread_cost = 1e5;		//Multiply-adds lost on starting thread
+
+	//Pattern and envelope of derivative matrix
+	Vector s;
+	BlockSparseMatrix d;
+	snapshot->get_initial_state(&s);
+	snapshot->get_tangent(&s, &d);
+	real n = (real)snapshot->get_variable_number();
+	_record.variables = snapshot->get_variable_number();
+	_record.stored_values = d.get_stored_value_count();
+	_record.envelope = d.get_envelope_size();
+	Symmetry symmetry(snapshot);
+	BlockSparseMatrix reduced;	//Derivative matrix of half model
+	_record.symmetric = symmetry.symmetric();
+	if (_record.symmetric) symmetry.create_reduced_matrix(&d, &reduced);
+	_record.linear = true;
+	for (uint i = 0; i < snapshot->get_stick_count(); i++)
+	{
+		if (dynamic_cast<const LinearMaterial*>(snapshot->get_stick_material(i)) == nullptr) _record.linear = false;
+	}
+	_record.available_memory = _get_available_memory();
+
+	//Costs of one Newton's iteration, assembly is common to all backends
+	real assembly = (real)_record.stored_values;
+	real solve = 2.0 * (real)_record.envelope + n;
+	real direct = d.get_factorization_cost() + solve;
+	real mixed = d.get_factorization_cost() / 2.0 + 3.0 * (solve + (real)_record.stored_values);
+	real half = reduced.get_factorization_cost() + 2.0 * (real)reduced.get_envelope_size() + (real)_record.stored_values;
+	real krylov = std::min((real)options->krylov_iterations, krylov_factor * sqrt(n)) * (2.0 * (real)_record.stored_values + (real)options->krylov_restart * n);
+	real direct_memory = sizeof(real) * (2.0 * (real)_record.envelope + n);
+	real mixed_memory = sizeof(float) * (2.0 * (real)_record.envelope + n);
+	real half_memory = sizeof(real) * (2.0 * (real)reduced.get_envelope_size() + n / 2.0);
+
+	//Cheapest backend that fits into memory
+	real cost = krylov;
+	_record.backend = Backend::matrix_free;
+	if (mixed_memory < memory_part * _record.available_memory && mixed < cost) { cost = mixed; _record.backend = Backend::mixed_precision; }
+	if (direct_memory < memory_part * _record.available_memory && direct <= cost) { cost = direct; _record.backend = Backend::direct; }
+	if (_record.symmetric && half_memory < memory_part * _record.available_memory && half < cost) { cost = half; _record.backend = Backend::half_model; }
+
+	//Decomposition pays off only with several threads, it's cost depends on size of boundary
+	_record.threads = (options->threads == 0) ? std::max(std::thread::hardware_concurrency(), 1u) : options->threads;
+	if (_record.threads > 1)
+	{
+		DomainDecomposition domains;
+		domains.create(&d, options->subdomains, _record.threads);
+		_record.boundary = domains.get_boundary_size();
+		real decomposition = domains.get_cost() + 2.0 * thread_cost * (real)_record.threads;
+		real decomposition_memory = direct_memory + sizeof(real) * sqr((real)_record.boundary);
+		if (decomposition_memory < memory_part * _record.available_memory && decomposition < cost) { cost = decomposition; _record.backend = Backend::decomposition; }
+	}
+	_record.estimated_time = (assembly + cost) / rate;
+
+	//Small-displacement solution of linear construction is a good first approximation
+	_record.linear_start = _record.linear && snapshot->get_superelement_count() == 0 && _record.backend != Backend::matrix_free;
+
+	if (_record.backend == Backend::matrix_free) _options.method = Snapshot::Method::matrix_free;
+	else if (_record.backend == Backend::decomposition) _options.method = Snapshot::Method::decomposition;
+	else _options.method = Snapshot::Method::direct;
+	_options.mixed_precision = _record.backend == Backend::mixed_precision;
+	_options.symmetry = _record.backend == Backend::half_model;
+}
+
+p6::Snapshot::Options p6::Dispatcher::get_options() const noexcept
+{
+	return _options;
+}
+
+const p6::Dispatcher::Record *p6::Dispatcher::get_record() const noexcept
+{
+	return &_record;
+}
+
+p6::Solution p6::Dispatcher::solve(const Snapshot *snapshot, const Solution *start)
+{
+	auto begin = std::chrono::steady_clock::now();
+	Solution solution;
+	bool solved = false;
+	if (start == nullptr && _record.linear_start)
+	{
+		LinearAnalysis linear(snapshot);
+		if (linear.stable())
+		{
+			//Displacements of first load step are added to initial state, rail nodes move along their rails
+			Vector s;
+			snapshot->get_initial_state(&s);
+			for (uint i = 0; i < snapshot->get_node_count(); i++)
+			{
+				uint variable[2];
+				snapshot->get_node_variable(i, variable);
+				Coord displacement = linear.get_node_displacement(i) / (real)_options.load_steps;
+				if (snapshot->get_node_freedom(i) == 2)
+				{
+					s(variable[0]) += displacement.x;
+					s(variable[1]) += displacement.y;
+				}
+				else if (snapshot->get_node_freedom(i) == 1)
+				{
+					real angle = snapshot->get_node_rail_angle(i);
+					s(variable[0]) += displacement.x * cos(angle) + displacement.y * sin(angle);
+				}
+			}
+			Solution linear_solution = snapshot->get_solution(&s);
+			try { solution = snapshot->solve(&_options, &linear_solution); solved = true; }
+			catch (ConvergenceError&) {}
+		}
+	}
+	if (!solved) solution = snapshot->solve(&_options, start);
+
+	_record.iterations = solution.get_iterations();
+	real time = std::chrono::duration<real>(std::chrono::steady_clock::now() - begin).count();
+	_record.actual_time = time / std::max(_record.iterations, (uint)1);
+	return solution;
+}
+
+p6::String p6::Dispatcher::message() const
+{
+	const char *backend[] = { "direct", "mixed precision", "half model", "matrix-free", "domain decomposition" };
+	String message = String("Solver: ") + backend[(uint)_record.backend];
+	if (_record.linear_start) message += " from small-displacement solution";
+	message += ", " + std::to_string(_record.variables) + " variables";
+	message += ", " + std::to_string(_record.stored_values) + " stored values";
+	message += ", envelope " + std::to_string(_record.envelope);
+	if (_record.boundary > 0) message += ", boundary " + std::to_string(_record.boundary) + " on " + std::to_string(_record.threads) + " threads";
+	if (_record.symmetric) message += ", symmetric";
+	message += _record.linear ? ", linear materials" : ", nonlinear materials";
+	message += ", estimated " + real_to_string(_record.estimated_time) + " s per iteration";
+	if (_record.iterations > 0) message += ", actual " + real_to_string(_record.actual_time) + " s per iteration in " + std::to_string(_record.iterations) + " iterations";
+	return message;
+}
@@ -0,0 +1,367 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#include "../header/p6_domain_decomposition.hpp"
+#include <cassert>
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+void p6::DomainDecomposition::_breadth_first(const std::vector<std::vector<uint>> *adjacency, uint root, std::vector<uint> *order, std::vector<bool> *visited)
+{
+	uint first = order->size();
+	order->push_back(root);
+	(*visited)[root] = true;
+	for (uint i = first; i < order->size(); i++)
+	{
+		const std::vector<uint> &neighbours = (*adjacency)[(*order)[i]];
+		for (uint j = 0; j < neighbours.size(); j++)
+		{
+			if ((*visited)[neighbours[j]]) continue;
+			(*visited)[neighbours[j]] = true;
+			order->push_back(neighbours[j]);
+		}
+	}
+}
+
+template <class F> void p6::DomainDecomposition::_parallel(F function) const
+{
+	//Subdomains are divided between threads in contiguous ranges
+	uint nsubdomain = _subdomain.size();
+	std::vector<std::thread> pool;
+	for (uint i = 1; i < _threads; i++) pool.push_back(std::thread(function, i * nsubdomain / _threads, (i + 1) * nsubdomain / _threads));
+	function(0, nsubdomain / _threads);
+	for (uint i = 0; i < pool.size(); i++) pool[i].join();
+}
+
+void p6::DomainDecomposition::create(const BlockSparseMatrix *d, uint subdomains, uint threads)
+{
+	if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+	if (subdomains == 0) subdomains = threads;
+	uint nblock = d->get_block_count();
+	_size = d->get_size();
+	subdomains = std::max(std::min(subdomains, nblock), (uint)1);
+
+	//Block graph
+	std::vector<uint> pattern;
+	d->get_block_pattern(&pattern);
+	std::vector<std::vector<uint>> adjacency(nblock);
+	for (uint i = 0; i < pattern.size(); i += 2) adjacency[pattern[i]].push_back(pattern[i + 1]);
+	std::vector<uint> start(nblock + 1, 0);
+	for (uint i = 0; i < nblock; i++) start[i + 1] = start[i] + d->get_block_size(i);
+
+	//Breadth-first order from pseudo-peripheral block of each component keeps neighbours close to each other
+	std::vector<uint> order;
+	std::vector<bool> visited(nblock, false);
+	for (uint i = 0; i < nblock; i++)
+	{
+		if (visited[i]) continue;
+		std::vector<uint> component;
+		std::vector<bool> probe = visited;
+		_breadth_first(&adjacency, i, &component, &probe);
+		_breadth_first(&adjacency, component.back(), &order, &visited);
+	}
+
+	//Order is cut into chunks with equal number of scalars
+	std::vector<uint> chunk(nblock);
+	uint passed = 0;
+	for (uint i = 0; i < nblock; i++)
+	{
+		chunk[order[i]] = std::min(passed * subdomains / _size, subdomains - 1);
+		passed += d->get_block_size(order[i]);
+	}
+
+	//Block coupled with later chunk belongs to boundary, so interiors of different chunks are never coupled
+	std::vector<uint> owner(nblock);		//Subdomain of interior block, -1 for boundary block
+	std::vector<uint> local(nblock);		//Local block index of interior block, first boundary index of boundary block
+	std::vector<uint> chunk_subdomain(subdomains, (uint)-1);
+	std::vector<std::vector<uint>> size;	//Block sizes of interior matrixes
+	_subdomain.clear();
+	_boundary.clear();
+	for (uint i = 0; i < nblock; i++)
+	{
+		bool boundary = false;
+		for (uint j = 0; j < adjacency[i].size(); j++)
+		{
+			if (chunk[adjacency[i][j]] > chunk[i]) boundary = true;
+		}
+		if (boundary)
+		{
+			owner[i] = (uint)-1;
+			local[i] = _boundary.size();
+			for (uint j = start[i]; j < start[i + 1]; j++) _boundary.push_back(j);
+			continue;
+		}
+		if (chunk_subdomain[chunk[i]] == (uint)-1)
+		{
+			chunk_subdomain[chunk[i]] = size.size();
+			size.push_back(std::vector<uint>());
+		}
+		owner[i] = chunk_subdomain[chunk[i]];
+		local[i] = size[owner[i]].size();
+		size[owner[i]].push_back(d->get_block_size(i));
+	}
+	_subdomain.resize(size.size());
+	for (uint i = 0; i < nblock; i++)
+	{
+		if (owner[i] == (uint)-1) continue;
+		for (uint j = start[i]; j < start[i + 1]; j++) _subdomain[owner[i]].interior.push_back(j);
+	}
+
+	//Interior patterns and boundary scalars coupled with interiors
+	std::vector<std::vector<uint>> interior_pattern(_subdomain.size());
+	for (uint i = 0; i < nblock; i++)
+	{
+		if (owner[i] == (uint)-1) continue;
+		Subdomain *subdomain = &_subdomain[owner[i]];
+		for (uint j = 0; j < adjacency[i].size(); j++)
+		{
+			uint neighbour = adjacency[i][j];
+			if (owner[neighbour] == (uint)-1)
+			{
+				for (uint k = 0; k < d->get_block_size(neighbour); k++) subdomain->boundary.push_back(local[neighbour] + k);
+			}
+			else if (neighbour > i)
+			{
+				assert(owner[neighbour] == owner[i]);
+				interior_pattern[owner[i]].push_back(local[i]);
+				interior_pattern[owner[i]].push_back(local[neighbour]);
+			}
+		}
+	}
+	for (uint i = 0; i < _subdomain.size(); i++)
+	{
+		Subdomain *subdomain = &_subdomain[i];
+		std::sort(subdomain->boundary.begin(), subdomain->boundary.end());
+		subdomain->boundary.erase(std::unique(subdomain->boundary.begin(), subdomain->boundary.end()), subdomain->boundary.end());
+		subdomain->matrix.create(size[i], interior_pattern[i]);
+		subdomain->right.clear();
+		subdomain->left.clear();
+		subdomain->schur.resize(subdomain->boundary.size(), subdomain->boundary.size());
+	}
+
+	//Local index of every scalar
+	std::vector<uint> scalar_owner(_size, (uint)-1), scalar_local(_size);
+	for (uint i = 0; i < _subdomain.size(); i++)
+	{
+		for (uint j = 0; j < _subdomain[i].interior.size(); j++)
+		{
+			scalar_owner[_subdomain[i].interior[j]] = i;
+			scalar_local[_subdomain[i].interior[j]] = j;
+		}
+	}
+	for (uint i = 0; i < _boundary.size(); i++) scalar_local[_boundary[i]] = i;
+
+	//Destinations of stored values, they are listed in the same order as values
+	std::vector<uint> row, column;
+	std::vector<real> value;
+	d->get_entries(&row, &column, &value);
+	_destination.resize(value.size());
+	for (uint i = 0; i < value.size(); i++)
+	{
+		Destination *destination = &_destination[i];
+		uint row_owner = scalar_owner[row[i]], column_owner = scalar_owner[column[i]];
+		uint row_local = scalar_local[row[i]], column_local = scalar_local[column[i]];
+		if (row_owner != (uint)-1 && column_owner != (uint)-1)
+		{
+			assert(row_owner == column_owner);
+			destination->kind = Kind::interior;
+			destination->subdomain = row_owner;
+			destination->row = _subdomain[row_owner].matrix.find(row_local, column_local);
+		}
+		else if (row_owner != (uint)-1)
+		{
+			const std::vector<uint> &boundary = _subdomain[row_owner].boundary;
+			Entry entry = { row_local, (uint)(std::lower_bound(boundary.begin(), boundary.end(), column_local) - boundary.begin()), 0.0 };
+			destination->kind = Kind::right;
+			destination->subdomain = row_owner;
+			destination->row = _subdomain[row_owner].right.size();
+			_subdomain[row_owner].right.push_back(entry);
+		}
+		else if (column_owner != (uint)-1)
+		{
+			const std::vector<uint> &boundary = _subdomain[column_owner].boundary;
+			Entry entry = { (uint)(std::lower_bound(boundary.begin(), boundary.end(), row_local) - boundary.begin()), column_local, 0.0 };
+			destination->kind = Kind::left;
+			destination->subdomain = column_owner;
+			destination->row = _subdomain[column_owner].left.size();
+			_subdomain[column_owner].left.push_back(entry);
+		}
+		else
+		{
+			destination->kind = Kind::boundary;
+			destination->subdomain = (uint)-1;
+			destination->row = row_local;
+			destination->column = column_local;
+		}
+	}
+	_schur.resize(_boundary.size(), _boundary.size());
+	_threads = std::max(std::min(threads, (uint)_subdomain.size()), (uint)1);
+}
+
+p6::uint p6::DomainDecomposition::get_subdomain_count() const noexcept
+{
+	return _subdomain.size();
+}
+
+p6::uint p6::DomainDecomposition::get_interior_size(uint subdomain) const noexcept
+{
+	return _subdomain[subdomain].interior.size();
+}
+
+p6::uint p6::DomainDecomposition::get_boundary_size() const noexcept
+{
+	return _boundary.size();
+}
+
+p6::real p6::DomainDecomposition::get_cost() const noexcept
+{
+	//Interior factorization, solution for coupled boundary scalars and two solutions of system
+	std::vector<real> cost(_subdomain.size());
+	real assembly = 0.0;
+	for (uint i = 0; i < _subdomain.size(); i++)
+	{
+		const Subdomain *subdomain = &_subdomain[i];
+		real solve = 2.0 * (real)subdomain->matrix.get_envelope_size() + (real)subdomain->interior.size();
+		real coupled = (real)subdomain->boundary.size();
+		cost[i] = subdomain->matrix.get_factorization_cost() + (coupled + 2.0) * solve + coupled * (real)subdomain->left.size();
+		assembly += coupled * coupled;
+	}
+
+	//Longest thread and dense boundary
+	real longest = 0.0;
+	uint nsubdomain = _subdomain.size();
+	for (uint i = 0; i < _threads; i++)
+	{
+		real thread = 0.0;
+		for (uint j = i * nsubdomain / _threads; j < (i + 1) * nsubdomain / _threads; j++) thread += cost[j];
+		longest = std::max(longest, thread);
+	}
+	real nboundary = (real)_boundary.size();
+	return longest + assembly + 2.0 / 3.0 * nboundary * nboundary * nboundary + 2.0 * nboundary * nboundary;
+}
+
+bool p6::DomainDecomposition::factorize(const BlockSparseMatrix *d)
+{
+	//Values are distributed between interiors, couplings and boundary
+	std::vector<real> value;
+	d->get_values(&value);
+	assert(value.size() == _destination.size());
+	for (uint i = 0; i < _subdomain.size(); i++) _subdomain[i].matrix.set_zero();
+	_schur.setZero();
+	real scale = 0.0;
+	for (uint i = 0; i < value.size(); i++)
+	{
+		const Destination *destination = &_destination[i];
+		scale = std::max(scale, abs(value[i]));
+		if (destination->kind == Kind::interior) _subdomain[destination->subdomain].matrix.value(destination->row) = value[i];
+		else if (destination->kind == Kind::right) _subdomain[destination->subdomain].right[destination->row].value = value[i];
+		else if (destination->kind == Kind::left) _subdomain[destination->subdomain].left[destination->row].value = value[i];
+		else _schur(destination->row, destination->column) = value[i];
+	}
+
+	//Interiors are factorized independently, A_ii^-1 * A_ib is found for batches of coupled boundary scalars
+	_parallel([this](uint first, uint last)
+	{
+		const uint batch = 32;
+		for (uint i = first; i < last; i++)
+		{
+			Subdomain *subdomain = &_subdomain[i];
+			uint ninterior = subdomain->interior.size(), ncoupled = subdomain->boundary.size();
+			subdomain->schur.setZero();
+			subdomain->factorized = subdomain->matrix.factorize();
+			if (!subdomain->factorized) continue;
+			for (uint begin = 0; begin < ncoupled; begin += batch)
+			{
+				uint end = std::min(begin + batch, ncoupled);
+				Matrix right(ninterior, end - begin), solved;
+				right.setZero();
+				for (uint j = 0; j < subdomain->right.size(); j++)
+				{
+					const Entry &entry = subdomain->right[j];
+					if (entry.column >= begin && entry.column < end) right(entry.row, entry.column - begin) = entry.value;
+				}
+				subdomain->matrix.solve(&right, &solved);
+				for (uint j = 0; j < subdomain->left.size(); j++)
+				{
+					const Entry &entry = subdomain->left[j];
+					for (uint k = begin; k < end; k++) subdomain->schur(entry.row, k) += entry.value * solved(entry.column, k - begin);
+				}
+			}
+		}
+	});
+
+	//Contributions of subdomains are subtracted from A_bb
+	for (uint i = 0; i < _subdomain.size(); i++)
+	{
+		const Subdomain *subdomain = &_subdomain[i];
+		if (!subdomain->factorized) return false;
+		for (uint j = 0; j < subdomain->boundary.size(); j++)
+		{
+			for (uint k = 0; k < subdomain->boundary.size(); k++) _schur(subdomain->boundary[j], subdomain->boundary[k]) -= subdomain->schur(j, k);
+		}
+	}
+	if (_boundary.empty()) return true;
+	_lu.compute(_schur);
+	const real tolerance = 100.0 * std::numeric_limits<real>::epsilon() * scale;
+	return (_lu.matrixLU().diagonal().cwiseAbs().array() > tolerance).all();
+}
+
+void p6::DomainDecomposition::solve(const Vector *b, Vector *x) const
+{
+	//Boundary right side is condensed with y_i = A_ii^-1 * b_i
+	x->resize(_size);
+	std::vector<Vector> condensed(_subdomain.size());
+	_parallel([this, b, &condensed](uint first, uint last)
+	{
+		for (uint i = first; i < last; i++)
+		{
+			const Subdomain *subdomain = &_subdomain[i];
+			Vector interior(subdomain->interior.size()), solved;
+			for (uint j = 0; j < subdomain->interior.size(); j++) interior(j) = (*b)(subdomain->interior[j]);
+			subdomain->matrix.solve(&interior, &solved);
+			condensed[i] = Vector::Zero(subdomain->boundary.size());
+			for (uint j = 0; j < subdomain->left.size(); j++)
+			{
+				const Entry &entry = subdomain->left[j];
+				condensed[i](entry.row) += entry.value * solved(entry.column);
+			}
+		}
+	});
+
+	//Boundary is solved with S * x_b = b_b - sum(A_bi * y_i)
+	Vector boundary(_boundary.size());
+	for (uint i = 0; i < _boundary.size(); i++) boundary(i) = (*b)(_boundary[i]);
+	for (uint i = 0; i < _subdomain.size(); i++)
+	{
+		for (uint j = 0; j < _subdomain[i].boundary.size(); j++) boundary(_subdomain[i].boundary[j]) -= condensed[i](j);
+	}
+	if (!_boundary.empty()) boundary = _lu.solve(boundary);
+	for (uint i = 0; i < _boundary.size(); i++) (*x)(_boundary[i]) = boundary(i);
+
+	//Interiors are solved with A_ii * x_i = b_i - A_ib * x_b, they write to different entries of x
+	_parallel([this, b, x, &boundary](uint first, uint last)
+	{
+		for (uint i = first; i < last; i++)
+		{
+			const Subdomain *subdomain = &_subdomain[i];
+			Vector interior(subdomain->interior.size()), solved;
+			for (uint j = 0; j < subdomain->interior.size(); j++) interior(j) = (*b)(subdomain->interior[j]);
+			for (uint j = 0; j < subdomain->right.size(); j++)
+			{
+				const Entry &entry = subdomain->right[j];
+				interior(entry.row) -= entry.value * boundary(subdomain->boundary[entry.column]);
+			}
+			subdomain->matrix.solve(&interior, &solved);
+			for (uint j = 0; j < subdomain->interior.size(); j++) (*x)(subdomain->interior[j]) = solved(j);
+		}
+	});
+}
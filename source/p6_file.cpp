@@ -21,6 +21,16 @@
 		return _file.IsOpened();
 	}
 
+	p6::uint p6::InputFile::size()
+	{
+		return (uint)_file.Length();
+	}
+
+	p6::uint p6::InputFile::position()
+	{
+		return (uint)_file.Tell();
+	}
+
 	void p6::InputFile::read(void *data, uint size)
 	{
 		_file.Read(data, size);
@@ -51,6 +61,20 @@
 		return _file.is_open();
 	}
 
+	p6::uint p6::InputFile::size()
+	{
+		std::streampos position = _file.tellg();
+		_file.seekg(0, std::ios::end);
+		std::streampos end = _file.tellg();
+		_file.seekg(position);
+		return (uint)end;
+	}
+
+	p6::uint p6::InputFile::position()
+	{
+		return (uint)_file.tellg();
+	}
+
 	void p6::InputFile::read(void *data, uint size)
 	{
 		_file.read((char*)data, size);
@@ -0,0 +1,312 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#include "../header/p6_linear_analysis.hpp"
+#include "../header/p6_material.hpp"
+#include <stdexcept>
+#include <cassert>
+#include <thread>
+#include <algorithm>
+
+p6::real p6::LinearAnalysis::_get_stiffness(uint stick) const noexcept
+{
+	uint node[2];
+	_snapshot.get_stick_node(stick, node);
+	real length = _snapshot.get_node_coord(node[1]).distance(_snapshot.get_node_coord(node[0]));
+	return _area[stick] * _material[stick]->derivative(0.0) / length;
+}
+
+void p6::LinearAnalysis::_get_stick_vector(uint stick, std::vector<uint> *variable, std::vector<real> *direction) const
+{
+	//Elongation is b^T * u = n^T * (u1 - u0)
+	uint node[2];
+	_snapshot.get_stick_node(stick, node);
+	Coord delta = _snapshot.get_node_coord(node[1]) - _snapshot.get_node_coord(node[0]);
+	Coord n = delta / delta.norm();
+	for (uint i = 0; i < 2; i++)
+	{
+		real sign = (i == 0) ? -1.0 : 1.0;
+		uint v[2];
+		_snapshot.get_node_variable(node[i], v);
+		unsigned char freedom = _snapshot.get_node_freedom(node[i]);
+		if (freedom == 1)
+		{
+			real angle = _snapshot.get_node_rail_angle(node[i]);
+			variable->push_back(v[0]);
+			direction->push_back(sign * (n.x * cos(angle) + n.y * sin(angle)));
+		}
+		else if (freedom == 2)
+		{
+			variable->push_back(v[0]);
+			direction->push_back(sign * n.x);
+			variable->push_back(v[1]);
+			direction->push_back(sign * n.y);
+		}
+	}
+}
+
+void p6::LinearAnalysis::_factorize() noexcept
+{
+	_factorization_count++;
+	_stable = _k.factorize_symmetric();
+	if (_stable) _k.solve(&_f, &_u);
+}
+
+void p6::LinearAnalysis::_update_stiffness(uint stick) noexcept
+{
+	//Rank-one update with (new - old) * b * b^T, factorization is recomputed if update fails
+	std::vector<uint> variable(_variable.begin() + 4 * stick, _variable.begin() + 4 * stick + 4);
+	std::vector<real> direction(_direction.begin() + 4 * stick, _direction.begin() + 4 * stick + 4);
+	uint count = 0;
+	while (count < 4 && variable[count] != (uint)-1) count++;
+	variable.resize(count);
+	direction.resize(count);
+	real stiffness = _get_stiffness(stick);
+	real sigma = stiffness - _stiffness[stick];
+	_stiffness[stick] = stiffness;
+	if (count == 0 || sigma == 0.0) return;
+
+	if (_stable && _k.update(&variable, &direction, sigma))
+	{
+		_update_count++;
+		_k.solve(&_f, &_u);
+	}
+	else _factorize();
+}
+
+p6::real p6::LinearAnalysis::_get_elongation(uint stick, const Vector *u) const noexcept
+{
+	real elongation = 0.0;
+	for (uint i = 0; i < 4 && _variable[4 * stick + i] != (uint)-1; i++) elongation += _direction[4 * stick + i] * (*u)(_variable[4 * stick + i]);
+	return elongation;
+}
+
+void p6::LinearAnalysis::_scan_redundancy(uint begin, uint end, real stress_limit, std::vector<Removal> *removal) const noexcept
+{
+	//Without stick K' = K - k * b * b^T, so u' = u + K^-1 * b * k * b^T * u / (1 - k * b^T * K^-1 * b)
+	//Denominator vanishes when b is not in range of remaining sticks, that is mechanism
+	uint nvariable = _u.size();
+	Vector b(nvariable), y, u;
+	for (uint i = begin; i < end; i++)
+	{
+		Removal *r = &removal->at(i);
+		b.setZero();
+		for (uint j = 0; j < 4 && _variable[4 * i + j] != (uint)-1; j++) b(_variable[4 * i + j]) = _direction[4 * i + j];
+		_k.solve(&b, &y);
+		real denominator = 1.0 - _stiffness[i] * b.dot(y);
+		if (denominator < 1e-8) { r->mechanism = true; continue; }
+		u = _u + y * (_stiffness[i] * b.dot(_u) / denominator);
+
+		for (uint j = 0; j < _stiffness.size(); j++)
+		{
+			if (j == i || _area[j] == 0.0) continue;
+			real stress = abs(_stiffness[j] * _get_elongation(j, &u) / _area[j]);
+			if (stress > r->max_stress) { r->max_stress = stress; r->critical_stick = j; }
+		}
+		r->overstressed = r->max_stress > stress_limit;
+	}
+}
+
+p6::LinearAnalysis::LinearAnalysis(const Snapshot *snapshot) : _snapshot(*snapshot)
+{
+	if (snapshot->get_superelement_count() > 0) throw std::runtime_error("Linear analysis does not support superelements");
+
+	//Blocks are nodes, fully free nodes go first like their variables
+	uint nfree2d = 0;
+	for (uint i = 0; i < snapshot->get_node_count(); i++)
+	{
+		if (snapshot->get_node_freedom(i) == 2) nfree2d++;
+	}
+	uint nvariable = snapshot->get_variable_number();
+	std::vector<uint> size(nvariable - nfree2d, 1);
+	for (uint i = 0; i < nfree2d; i++) size[i] = 2;
+	auto block = [nfree2d](uint variable) { return (variable < 2 * nfree2d) ? variable / 2 : variable - nfree2d; };
+
+	//Sticks
+	std::vector<uint> pattern;
+	_area.resize(snapshot->get_stick_count());
+	_material.resize(snapshot->get_stick_count());
+	_stiffness.resize(snapshot->get_stick_count());
+	_variable.assign(4 * snapshot->get_stick_count(), (uint)-1);
+	_direction.assign(4 * snapshot->get_stick_count(), 0.0);
+	for (uint i = 0; i < snapshot->get_stick_count(); i++)
+	{
+		_area[i] = snapshot->get_stick_area(i);
+		_material[i] = snapshot->get_stick_material(i);
+		_stiffness[i] = _get_stiffness(i);
+		std::vector<uint> variable;
+		std::vector<real> direction;
+		_get_stick_vector(i, &variable, &direction);
+		for (uint j = 0; j < variable.size(); j++)
+		{
+			_variable[4 * i + j] = variable[j];
+			_direction[4 * i + j] = direction[j];
+			for (uint k = 0; k < j; k++)
+			{
+				pattern.push_back(block(variable[j]));
+				pattern.push_back(block(variable[k]));
+			}
+		}
+	}
+	_k.create(size, pattern);
+	for (uint i = 0; i < snapshot->get_stick_count(); i++)
+	{
+		for (uint j = 0; j < 4 && _variable[4 * i + j] != (uint)-1; j++)
+		{
+			for (uint k = 0; k < 4 && _variable[4 * i + k] != (uint)-1; k++)
+				_k.at(_variable[4 * i + j], _variable[4 * i + k]) += _stiffness[i] * _direction[4 * i + j] * _direction[4 * i + k];
+		}
+	}
+
+	//External forces, projected on rail
+	_f.setZero(nvariable);
+	for (uint i = 0; i < snapshot->get_force_count(); i++)
+	{
+		uint node = snapshot->get_force_node(i);
+		Coord force = snapshot->get_force_direction(i);
+		uint variable[2];
+		snapshot->get_node_variable(node, variable);
+		if (snapshot->get_node_freedom(node) == 1)
+		{
+			real angle = snapshot->get_node_rail_angle(node);
+			_f(variable[0]) += force.x * cos(angle) + force.y * sin(angle);
+		}
+		else if (snapshot->get_node_freedom(node) == 2)
+		{
+			_f(variable[0]) += force.x;
+			_f(variable[1]) += force.y;
+		}
+	}
+	_u.setZero(nvariable);
+	_factorize();
+}
+
+void p6::LinearAnalysis::set_stick_area(uint stick, real area) noexcept
+{
+	assert(area == area);
+	_area[stick] = area;
+	_update_stiffness(stick);
+}
+
+void p6::LinearAnalysis::set_stick_material(uint stick, const Material *material) noexcept
+{
+	assert(material != nullptr);
+	_material[stick] = material;
+	_update_stiffness(stick);
+}
+
+bool p6::LinearAnalysis::stable() const noexcept
+{
+	return _stable;
+}
+
+p6::Coord p6::LinearAnalysis::get_node_displacement(uint node) const noexcept
+{
+	assert(_stable);
+	uint variable[2];
+	_snapshot.get_node_variable(node, variable);
+	unsigned char freedom = _snapshot.get_node_freedom(node);
+	if (freedom == 1)
+	{
+		real angle = _snapshot.get_node_rail_angle(node);
+		return Coord(cos(angle), sin(angle)) * _u(variable[0]);
+	}
+	else if (freedom == 2) return Coord(_u(variable[0]), _u(variable[1]));
+	else return Coord(0.0, 0.0);
+}
+
+p6::real p6::LinearAnalysis::get_stick_force(uint stick) const noexcept
+{
+	assert(_stable);
+	return _stiffness[stick] * _get_elongation(stick, &_u);
+}
+
+p6::uint p6::LinearAnalysis::get_update_count() const noexcept
+{
+	return _update_count;
+}
+
+p6::uint p6::LinearAnalysis::get_factorization_count() const noexcept
+{
+	return _factorization_count;
+}
+
+void p6::LinearAnalysis::get_influence_lines(const std::vector<uint> *node, Coord load, Matrix *force) const
+{
+	//Every load position is right-hand side of the same factorized system
+	assert(_stable);
+	uint nvariable = _u.size();
+	Matrix f(nvariable, node->size()), u;
+	f.setZero();
+	for (uint i = 0; i < node->size(); i++)
+	{
+		uint variable[2];
+		_snapshot.get_node_variable(node->at(i), variable);
+		unsigned char freedom = _snapshot.get_node_freedom(node->at(i));
+		if (freedom == 1)
+		{
+			real angle = _snapshot.get_node_rail_angle(node->at(i));
+			f(variable[0], i) = load.x * cos(angle) + load.y * sin(angle);
+		}
+		else if (freedom == 2)
+		{
+			f(variable[0], i) = load.x;
+			f(variable[1], i) = load.y;
+		}
+	}
+	_k.solve(&f, &u);
+
+	force->resize(_stiffness.size(), node->size());
+	for (uint i = 0; i < _stiffness.size(); i++)
+	{
+		for (uint j = 0; j < node->size(); j++)
+		{
+			real elongation = 0.0;
+			for (uint k = 0; k < 4 && _variable[4 * i + k] != (uint)-1; k++) elongation += _direction[4 * i + k] * u(_variable[4 * i + k], j);
+			(*force)(i, j) = _stiffness[i] * elongation;
+		}
+	}
+}
+
+void p6::LinearAnalysis::get_force_envelope(const std::vector<uint> *node, Coord load, std::vector<real> *min, std::vector<real> *max) const
+{
+	Matrix force;
+	get_influence_lines(node, load, &force);
+	min->resize(_stiffness.size());
+	max->resize(_stiffness.size());
+	for (uint i = 0; i < _stiffness.size(); i++)
+	{
+		real base = get_stick_force(i);
+		(*min)[i] = (*max)[i] = base;
+		for (uint j = 0; j < node->size(); j++)
+		{
+			(*min)[i] = std::min((*min)[i], base + force(i, j));
+			(*max)[i] = std::max((*max)[i], base + force(i, j));
+		}
+	}
+}
+
+void p6::LinearAnalysis::scan_redundancy(real stress_limit, uint threads, std::vector<Removal> *removal) const
+{
+	//Factorization is only read, so sticks are divided between threads
+	assert(_stable);
+	removal->assign(_stiffness.size(), Removal());
+	if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+	threads = std::max(std::min(threads, (uint)_stiffness.size()), (uint)1);
+	std::vector<std::thread> pool;
+	for (uint i = 1; i < threads; i++)
+	{
+		pool.push_back(std::thread(&LinearAnalysis::_scan_redundancy, this,
+			i * _stiffness.size() / threads, (i + 1) * _stiffness.size() / threads, stress_limit, removal));
+	}
+	_scan_redundancy(0, _stiffness.size() / threads, stress_limit, removal);
+	for (uint i = 0; i < pool.size(); i++) pool[i].join();
+}
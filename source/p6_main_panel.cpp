@@ -10,6 +10,7 @@
 
 #include "../header/p6_main_panel.hpp"
 #include "../header/p6_frame.hpp"
+#include "../header/p6_trace.hpp"
 
 wxPoint p6::MainPanel::_real_to_pixel(Coord coord, wxPoint offset) const noexcept
 {
@@ -39,6 +40,8 @@ wxSize p6::MainPanel::size() const noexcept
 
 void p6::MainPanel::render(wxDC *dc, wxPoint offset) const noexcept
 {
+	TraceScope trace("MainPanel::render");
+
 	//Clear background
 	dc->SetBackground(wxBrush(wxColour(255, 255, 255)));
 	dc->Clear();
@@ -10,6 +10,7 @@
 
 #include "../header/p6_menubar.hpp"
 #include "../header/p6_frame.hpp"
+#include "../header/p6_trace.hpp"
 
 void p6::MenuBar::_on_file_load(wxCommandEvent &e)
 {
@@ -71,6 +72,31 @@ void p6::MenuBar::_on_file_import(wxCommandEvent &e)
 	}
 }
 
+void p6::MenuBar::_on_file_import_superelement(wxCommandEvent &e)
+{
+	wxFileDialog dialog(_frame->frame(), "Import P6 File As Superelement", "", "", "P6 File (*.p6)|*.p6", wxFD_OPEN | wxFD_FILE_MUST_EXIST);
+	if (dialog.ShowModal() != wxID_CANCEL)
+	{
+		try
+		{
+			uint superelement = _frame->construction()->import_superelement(dialog.GetPath().ToStdString(), Construction::Condensation::linear);
+			_frame->main_panel()->selected_nodes.clear();
+			for (uint i = 0; i < _frame->construction()->get_superelement_node_count(superelement); i++)
+			{
+				_frame->main_panel()->selected_nodes.insert(_frame->construction()->get_superelement_node(superelement, i));
+			}
+			_frame->main_panel()->selected_sticks.clear();
+			_frame->main_panel()->selected_forces.clear();
+			_frame->main_panel()->need_refresh();
+			_frame->side_panel()->refresh();
+		}
+		catch (std::exception &e)
+		{
+			wxMessageBox(e.what(), "Error", wxICON_ERROR, _frame->frame());
+		}
+	}
+}
+
 void p6::MenuBar::_on_file_save(wxCommandEvent &e)
 {
 	if (_file == "")
@@ -145,6 +171,28 @@ void p6::MenuBar::_on_view_grid(wxCommandEvent &e)
 	_frame->main_panel()->grid_draw(e.IsChecked());
 }
 
+void p6::MenuBar::_on_trace_record(wxCommandEvent &e)
+{
+	if (e.IsChecked()) Trace::clear();
+	Trace::enable(e.IsChecked());
+}
+
+void p6::MenuBar::_on_trace_save(wxCommandEvent &e)
+{
+	wxFileDialog dialog(_frame->frame(), "Save Trace", "", "", "Chrome Trace (*.json)|*.json", wxFD_SAVE);
+	if (dialog.ShowModal() != wxID_CANCEL)
+	{
+		try
+		{
+			Trace::write(dialog.GetPath().ToStdString());
+		}
+		catch (std::exception &e)
+		{
+			wxMessageBox(e.what(), "Error", wxICON_ERROR, _frame->frame());
+		}
+	}
+}
+
 void p6::MenuBar::_on_help(wxCommandEvent &e)
 {
 	const char *help = R"(
@@ -175,6 +223,8 @@ p6::MenuBar::MenuBar(Frame *frame) noexcept : _frame(frame)
 	frame->frame()->Bind(wxEVT_MENU, &MenuBar::_on_file_load, this, _file_load->GetId());
 	_file_import = filemenu->Append(wxID_ANY, "Import", "Import construction from file");
 	frame->frame()->Bind(wxEVT_MENU, &MenuBar::_on_file_import, this, _file_import->GetId());
+	_file_import_superelement = filemenu->Append(wxID_ANY, "Import superelement", "Import construction condensed to it's fixed nodes");
+	frame->frame()->Bind(wxEVT_MENU, &MenuBar::_on_file_import_superelement, this, _file_import_superelement->GetId());
 	wxMenuItem *item = filemenu->Append(wxID_ANY, "Save", "Save construction to file");
 	frame->frame()->Bind(wxEVT_MENU, &MenuBar::_on_file_save, this, item->GetId());
 	item = filemenu->Append(wxID_ANY, "Save as", "Save construction another file");
@@ -195,6 +245,14 @@ p6::MenuBar::MenuBar(Frame *frame) noexcept : _frame(frame)
 	frame->frame()->Bind(wxEVT_MENU, &MenuBar::_on_view_grid, this, item->GetId());
 	menubar->Append(viewmenu, "View");
 
+	//Trace
+	wxMenu *tracemenu = new wxMenu();
+	item = tracemenu->AppendCheckItem(wxID_ANY, "Record", "Start and stop recording time of simulation phases");
+	frame->frame()->Bind(wxEVT_MENU, &MenuBar::_on_trace_record, this, item->GetId());
+	item = tracemenu->Append(wxID_ANY, "Save trace", "Save recorded events in Chrome trace format");
+	frame->frame()->Bind(wxEVT_MENU, &MenuBar::_on_trace_save, this, item->GetId());
+	menubar->Append(tracemenu, "Trace");
+
 	//Help
 	wxMenu *helpmenu = new wxMenu();
 	item = helpmenu->Append(wxID_ANY, "Help", "Get help");
@@ -209,4 +267,5 @@ void p6::MenuBar::refresh() noexcept
 	bool sim = _frame->toolbar()->simulation();
 	_file_load->Enable(!sim);
 	_file_import->Enable(!sim);
+	_file_import_superelement->Enable(!sim);
 }
\ No newline at end of file
@@ -0,0 +1,181 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#include "../header/p6_modal_analysis.hpp"
+#include "../header/p6_snapshot.hpp"
+#include "../header/p6_math.hpp"
+#include "../header/p6_block_sparse_matrix.hpp"
+#include <stdexcept>
+#include <cassert>
+#include <algorithm>
+
+p6::ModalAnalysis::ModalAnalysis(const Snapshot *snapshot, const Solution *solution, const std::vector<real> *density, uint nmode, real shift)
+{
+	assert(density->size() == snapshot->get_stick_count());
+
+	//Lumped masses
+	uint nnode = snapshot->get_node_count();
+	_mass.assign(nnode, 0.0);
+	for (uint i = 0; i < snapshot->get_stick_count(); i++)
+	{
+		uint node[2];
+		snapshot->get_stick_node(i, node);
+		real length = snapshot->get_node_coord(node[1]).distance(snapshot->get_node_coord(node[0]));
+		real mass = length * snapshot->get_stick_area(i) * (*density)[i];
+		_mass[node[0]] += mass / 2.0;
+		_mass[node[1]] += mass / 2.0;
+	}
+	uint nvariable = snapshot->get_variable_number();
+	Vector mass(nvariable);
+	for (uint i = 0; i < nnode; i++)
+	{
+		uint variable[2];
+		snapshot->get_node_variable(i, variable);
+		for (uint j = 0; j < 2; j++)
+		{
+			if (variable[j] == (uint)-1) continue;
+			if (!(_mass[i] > 0.0)) throw std::runtime_error("Free node has no mass");
+			mass(variable[j]) = _mass[i];
+		}
+	}
+	nmode = std::min(nmode, nvariable);
+	if (nmode == 0) { _converged = true; return; }
+
+	//Stiffness is negative derivative of should-be-zero value, shifted matrix is K - shift * M
+	Vector s;
+	snapshot->get_state(solution, &s);
+	BlockSparseMatrix k;
+	snapshot->get_tangent(&s, &k);
+	std::vector<real> value;
+	k.get_values(&value);
+	for (uint i = 0; i < value.size(); i++) value[i] = -value[i];
+	k.set_values(&value);
+	for (uint i = 0; i < nvariable; i++) k.at(i, i) -= shift * mass(i);
+	if (!k.factorize()) throw std::runtime_error("Shifted stiffness matrix is singular");
+
+	//Lanczos vectors are M-orthonormal, operator has eigenvalues 1 / (eigenvalue - shift)
+	std::vector<Vector> lanczos;
+	std::vector<real> alpha, beta;
+	Vector v(nvariable);
+	for (uint i = 0; i < nvariable; i++) v(i) = 1.0 + 0.5 * sin((real)i);
+	v /= sqrt(v.dot(mass.cwiseProduct(v)));
+	Eigen::SelfAdjointEigenSolver<Eigen::Matrix<real, Eigen::Dynamic, Eigen::Dynamic>> ritz;
+	std::vector<uint> wanted;
+	while (true)
+	{
+		lanczos.push_back(v);
+		Vector mv = mass.cwiseProduct(v), w;
+		k.solve(&mv, &w);
+		alpha.push_back(w.dot(mv));
+
+		//Full reorthogonalization, done twice, replaces three-term recurrence and keeps vectors orthogonal in finite precision
+		for (uint pass = 0; pass < 2; pass++)
+		{
+			for (uint i = 0; i < lanczos.size(); i++) w -= lanczos[i].dot(mass.cwiseProduct(w)) * lanczos[i];
+		}
+		real b = sqrt(w.dot(mass.cwiseProduct(w)));
+		_iterations++;
+
+		//Ritz values of tridiagonal matrix, wanted ones are largest by absolute value
+		uint size = (uint)alpha.size();
+		bool breakdown = !(b > 1e-12 * abs(alpha.front())) || size == nvariable;
+		if (size >= nmode || breakdown)
+		{
+			Matrix t = Matrix::Zero(size, size);
+			for (uint i = 0; i < size; i++) t(i, i) = alpha[i];
+			for (uint i = 0; i + 1 < size; i++) t(i, i + 1) = t(i + 1, i) = beta[i];
+			ritz.compute(t);
+			wanted.resize(size);
+			for (uint i = 0; i < size; i++) wanted[i] = i;
+			std::sort(wanted.begin(), wanted.end(), [&ritz](uint a, uint b) { return abs(ritz.eigenvalues()(a)) > abs(ritz.eigenvalues()(b)); });
+			wanted.resize(std::min(nmode, size));
+
+			//Residual of Ritz pair is b times last entry of it's eigenvector
+			_converged = wanted.size() == nmode;
+			for (uint i = 0; i < wanted.size(); i++)
+			{
+				if (b * abs(ritz.eigenvectors()(size - 1, wanted[i])) > 1e-10 * abs(ritz.eigenvalues()(wanted[i]))) _converged = false;
+			}
+			if (_converged || breakdown) break;
+		}
+		beta.push_back(b);
+		v = w / b;
+	}
+
+	//Modes sorted by eigenvalue
+	std::vector<real> eigenvalue(wanted.size());
+	for (uint i = 0; i < wanted.size(); i++) eigenvalue[i] = shift + 1.0 / ritz.eigenvalues()(wanted[i]);
+	std::vector<uint> order(wanted.size());
+	for (uint i = 0; i < order.size(); i++) order[i] = i;
+	std::sort(order.begin(), order.end(), [&eigenvalue](uint a, uint b) { return eigenvalue[a] < eigenvalue[b]; });
+
+	_eigenvalue.resize(wanted.size());
+	_shape.resize(wanted.size() * nnode);
+	for (uint i = 0; i < order.size(); i++)
+	{
+		_eigenvalue[i] = eigenvalue[order[i]];
+		Vector x = Vector::Zero(nvariable);
+		for (uint j = 0; j < lanczos.size(); j++) x += ritz.eigenvectors()(j, wanted[order[i]]) * lanczos[j];
+		x /= sqrt(x.dot(mass.cwiseProduct(x)));
+		for (uint j = 0; j < nnode; j++)
+		{
+			uint variable[2];
+			snapshot->get_node_variable(j, variable);
+			Coord *shape = &_shape[i * nnode + j];
+			if (snapshot->get_node_freedom(j) == 2) *shape = Coord(x(variable[0]), x(variable[1]));
+			else if (snapshot->get_node_freedom(j) == 1)
+			{
+				real angle = snapshot->get_node_rail_angle(j);
+				*shape = Coord(cos(angle), sin(angle)) * x(variable[0]);
+			}
+			else *shape = Coord(0.0, 0.0);
+		}
+	}
+}
+
+bool p6::ModalAnalysis::converged() const noexcept
+{
+	return _converged;
+}
+
+p6::uint p6::ModalAnalysis::get_iterations() const noexcept
+{
+	return _iterations;
+}
+
+p6::uint p6::ModalAnalysis::get_mode_count() const noexcept
+{
+	return (uint)_eigenvalue.size();
+}
+
+p6::real p6::ModalAnalysis::get_eigenvalue(uint mode) const noexcept
+{
+	assert(mode < _eigenvalue.size());
+	return _eigenvalue[mode];
+}
+
+p6::real p6::ModalAnalysis::get_frequency(uint mode) const noexcept
+{
+	assert(mode < _eigenvalue.size());
+	return _eigenvalue[mode] > 0.0 ? sqrt(_eigenvalue[mode]) : 0.0;
+}
+
+p6::Coord p6::ModalAnalysis::get_mode_shape(uint mode, uint node) const noexcept
+{
+	assert(mode < _eigenvalue.size() && node < _mass.size());
+	return _shape[mode * _mass.size() + node];
+}
+
+p6::real p6::ModalAnalysis::get_node_mass(uint node) const noexcept
+{
+	assert(node < _mass.size());
+	return _mass[node];
+}
@@ -10,9 +10,11 @@
 
 #include "../header/p6_mouse.hpp"
 #include "../header/p6_frame.hpp"
+#include "../header/p6_trace.hpp"
 
 void p6::Mouse::_on_left_down(wxMouseEvent &e)
 {
+	TraceScope trace("Mouse::_on_left_down");
 	_frame->main_panel()->panel()->SetFocus();
 	_pressed_item = _frame->main_panel()->get_item(e.GetPosition());
 	_pressed_point = e.GetPosition();
@@ -22,6 +24,7 @@ void p6::Mouse::_on_left_down(wxMouseEvent &e)
 
 void p6::Mouse::_on_left_up(wxMouseEvent &e)
 {
+	TraceScope trace("Mouse::_on_left_up");
 	ToolBar *toolbar = _frame->toolbar();
 	
 	//Delete node/stick/force
@@ -143,6 +146,7 @@ void p6::Mouse::_on_left_up(wxMouseEvent &e)
 
 void p6::Mouse::_on_move(wxMouseEvent &e)
 {
+	TraceScope trace("Mouse::_on_move");
 	if (!_pressed) return;
 	ToolBar *toolbar = _frame->toolbar();
 	
@@ -214,6 +218,7 @@ void p6::Mouse::_on_move(wxMouseEvent &e)
 
 void p6::Mouse::_on_wheel(wxMouseEvent &e)
 {
+	TraceScope trace("Mouse::_on_wheel");
 	if (_pressed) return;
 
 	wxPoint point = e.GetPosition();
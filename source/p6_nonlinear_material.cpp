@@ -20,7 +20,6 @@ p6::NonlinearMaterial::NonlinearMaterial(const String name, const String formula
 	if (name == "") throw std::runtime_error("Material name can not be empty");
 	_name = name;
 	_formula = formula;
-	_last_strain = nan("");
 
 	//Prinary check (check illegal symbols)
 	for (uint i = 0; i < formula.size(); i++)
@@ -212,11 +211,22 @@ p6::NonlinearMaterial::NonlinearMaterial(const String name, const String formula
 		else
 		{
 			_operations.push_back(Operation::PUTR);
-			_operations.resize(_operations.size()+sizeof(real));
-			memcpy(&_operations[_operations.size()-sizeof(real)], &left.back().number, sizeof(real));
+			_constants.push_back(left.back().number);
 			left.pop_back();
 		}
 	}
+
+	//Calculating stack depth, operands are pushed, binary operators pop one element
+	uint depth = 0;
+	for (uint i = 0; i < _operations.size(); i++)
+	{
+		if (_operations[i] == Operation::PUTR || _operations[i] == Operation::PUTS) depth++;
+		else if (_operations[i] == Operation::ADD
+			|| _operations[i] == Operation::SUB
+			|| _operations[i] == Operation::MUL
+			|| _operations[i] == Operation::DIV) depth--;
+		if (depth > _depth) _depth = depth;
+	}
 }
 
 p6::String p6::NonlinearMaterial::formula() const noexcept
@@ -231,99 +241,107 @@ p6::Material::Type p6::NonlinearMaterial::type() const noexcept
 
 p6::real p6::NonlinearMaterial::stress(real strain) const noexcept
 {
-	if (strain != _last_strain)
-	{
-		_last_strain = strain;
-		_calculate();
-	}
-	return _last_stress;
+	real stress, derivative;
+	_calculate(strain, &stress, &derivative);
+	return stress;
 }
 
 p6::real p6::NonlinearMaterial::derivative(real strain) const noexcept
 {
-	if (strain != _last_strain)
-	{
-		_last_strain = strain;
-		_calculate();
-	}
-	return _last_derivative;
+	real stress, derivative;
+	_calculate(strain, &stress, &derivative);
+	return derivative;
+}
+
+void p6::NonlinearMaterial::calculate(real strain, real *stress, real *derivative) const noexcept
+{
+	_calculate(strain, stress, derivative);
 }
 
-void p6::NonlinearMaterial::_calculate() const noexcept
+void p6::NonlinearMaterial::_calculate(real strain, real *stress, real *derivative) const noexcept
 {
-	std::vector<StackElement> stack;
+	//Stack of usual formula fits into fixed buffer, deeper formulas allocate it once per calculation
+	const uint capacity = 64;
+	StackElement buffer[capacity];
+	std::vector<StackElement> allocated;
+	StackElement *stack = buffer;
+	if (_depth > capacity)
+	{
+		allocated.resize(_depth);
+		stack = allocated.data();
+	}
 
-	//Execute
-	uint i = 0;
-	while (i < _operations.size())
+	//Execute, top points to last element
+	StackElement *top = stack - 1;
+	const real *constant = _constants.data();
+	for (uint i = 0; i < _operations.size(); i++)
 	{
-		switch (_operations[i++])
+		switch (_operations[i])
 		{
 		case Operation::PUTR:
-			stack.resize(stack.size() + 1);
-			memcpy(&stack.back().value, &_operations[i], sizeof(real));
-			stack.back().derivative = 0.0;
-			i += sizeof(real);
+			top++;
+			top->value = *constant++;
+			top->derivative = 0.0;
 			break;
 
 		case Operation::PUTS:
-			stack.resize(stack.size() + 1);
-			stack.back().value = _last_strain;
-			stack.back().derivative = 1.0;
+			top++;
+			top->value = strain;
+			top->derivative = 1.0;
 			break;
 
 		case Operation::ADD:
-			(stack.end() - 2)->value += stack.back().value;
-			(stack.end() - 2)->derivative += stack.back().derivative;
-			stack.pop_back();
+			(top - 1)->value += top->value;
+			(top - 1)->derivative += top->derivative;
+			top--;
 			break;
 
 		case Operation::SUB:
-			(stack.end() - 2)->value = stack.back().value - (stack.end() - 2)->value;
-			(stack.end() - 2)->derivative = stack.back().derivative - (stack.end() - 2)->derivative;
-			stack.pop_back();
+			(top - 1)->value = top->value - (top - 1)->value;
+			(top - 1)->derivative = top->derivative - (top - 1)->derivative;
+			top--;
 			break;
 
 		case Operation::MUL:
-			(stack.end() - 2)->derivative =
-				(stack.end() - 2)->value * stack.back().derivative + 
-				(stack.end() - 2)->derivative * stack.back().value;
-			(stack.end() - 2)->value *= stack.back().value;
-			stack.pop_back();
+			(top - 1)->derivative =
+				(top - 1)->value * top->derivative +
+				(top - 1)->derivative * top->value;
+			(top - 1)->value *= top->value;
+			top--;
 			break;
 
 		case Operation::DIV:
-			(stack.end() - 2)->derivative =
-				(stack.back().derivative * (stack.end() - 2)->value -
-				stack.back().value * (stack.end() - 2)->derivative) /
-				 ((stack.end() - 2)->value * (stack.end() - 2)->value);
-			(stack.end() - 2)->value = stack.back().value / (stack.end() - 2)->value;
-			stack.pop_back();
+			(top - 1)->derivative =
+				(top->derivative * (top - 1)->value -
+				top->value * (top - 1)->derivative) /
+				 ((top - 1)->value * (top - 1)->value);
+			(top - 1)->value = top->value / (top - 1)->value;
+			top--;
 			break;
 
 		case Operation::NEG:
-			stack.back().derivative = -stack.back().derivative;
-			stack.back().value = -stack.back().value;
+			top->derivative = -top->derivative;
+			top->value = -top->value;
 			break;
 
 		case Operation::SIN:
-			stack.back().derivative = cos(stack.back().value) * stack.back().derivative;
-			stack.back().value = sin(stack.back().value);
+			top->derivative = cos(top->value) * top->derivative;
+			top->value = sin(top->value);
 			break;
 
 		case Operation::COS:
-			stack.back().derivative = -sin(stack.back().value) * stack.back().derivative;
-			stack.back().value = cos(stack.back().value);
+			top->derivative = -sin(top->value) * top->derivative;
+			top->value = cos(top->value);
 			break;
 
 		case Operation::LN:
-			stack.back().derivative = stack.back().derivative / stack.back().value;
-			stack.back().value = log(stack.back().value);
+			top->derivative = top->derivative / top->value;
+			top->value = log(top->value);
 			break;
 
 		case Operation::EXP:
-			stack.back().derivative = stack.back().value * stack.back().derivative;
-			stack.back().value = exp(stack.back().value);
+			top->derivative = top->value * top->derivative;
+			top->value = exp(top->value);
 			break;
 
 		default:
@@ -332,9 +350,9 @@ void p6::NonlinearMaterial::_calculate() const noexcept
 	}
 
 	//Checking stack
-	assert(stack.size() == 1);
+	assert(top == stack);
 
 	//Saving result
-	_last_stress = stack[0].value;
-	_last_derivative = stack[0].derivative;
+	*stress = stack[0].value;
+	*derivative = stack[0].derivative;
 }
@@ -0,0 +1,120 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#include "../header/p6_reduced_model.hpp"
+#include <cassert>
+
+p6::ReducedModel::ReducedModel(real tolerance) noexcept : _tolerance(tolerance)
+{}
+
+void p6::ReducedModel::add_sample(const Snapshot *snapshot, const Solution *solution)
+{
+	Vector s, s0;
+	snapshot->get_state(solution, &s);
+	snapshot->get_initial_state(&s0);
+	assert(_sample.empty() || _sample.front().size() == s.size());
+	_sample.push_back(s - s0);
+}
+
+p6::uint p6::ReducedModel::get_sample_count() const noexcept
+{
+	return (uint)_sample.size();
+}
+
+p6::uint p6::ReducedModel::create_basis(real energy)
+{
+	//Left singular vectors of sample matrix, ordered by singular value
+	if (_sample.empty()) { _basis.resize(0, 0); return 0; }
+	Matrix samples(_sample.front().size(), _sample.size());
+	for (uint i = 0; i < _sample.size(); i++) samples.col(i) = _sample[i];
+	Eigen::JacobiSVD<Eigen::Matrix<real, Eigen::Dynamic, Eigen::Dynamic>> svd(samples, Eigen::ComputeThinU);
+	const Vector singular = svd.singularValues();
+
+	//Modes are taken until their energy (sum of squared singular values) is large enough, negligible modes are never taken
+	real total = singular.squaredNorm();
+	real captured = 0.0;
+	uint nmode = 0;
+	while (nmode < (uint)singular.size() && singular(nmode) > 1e-12 * singular(0) && captured < energy * total)
+	{
+		captured += sqr(singular(nmode));
+		nmode++;
+	}
+	_basis = svd.matrixU().leftCols(nmode);
+	return nmode;
+}
+
+p6::uint p6::ReducedModel::get_mode_count() const noexcept
+{
+	return (uint)_basis.cols();
+}
+
+p6::Solution p6::ReducedModel::solve(const Snapshot *snapshot, const Snapshot::Options *options)
+{
+	//Unbalanced forces of initial state are external forces, they scale tolerance
+	Vector s0, s, z;
+	snapshot->get_initial_state(&s0);
+	snapshot->get_residual(&s0, &z);
+	real scale = z.size() == 0 ? 0.0 : z.cwiseAbs().maxCoeff();
+	if (scale == 0.0) { _reduced_count++; return snapshot->get_solution(&s0); }
+
+	//Newton's iterations in reduced space, stop when full forces are balanced or reduced modification vanishes
+	const uint max_iterations = 50;
+	uint nmode = get_mode_count();
+	bool converged = false, stalled = false;
+	Vector q = Vector::Zero(nmode);
+	s = s0;
+	if (nmode > 0 && _tangent.get_size() != (uint)s.size()) snapshot->create_tangent(&_tangent, &_scatter);
+	for (uint iteration = 0; nmode > 0 && (uint)_basis.rows() == (uint)s.size(); iteration++)
+	{
+		snapshot->get_residual(&s, &z);
+		if (z.cwiseAbs().maxCoeff() <= _tolerance * scale) { converged = true; break; }
+		if (stalled || iteration == max_iterations) break;
+
+		//Reduced derivative V^T * d * V, pattern of d is created once per model
+		snapshot->get_tangent(&s, &_scatter, &_tangent);
+		Matrix dv(s.size(), nmode);
+		for (uint i = 0; i < nmode; i++)
+		{
+			Vector v = _basis.col(i), product;
+			_tangent.multiply(&v, &product);
+			dv.col(i) = product;
+		}
+		Matrix dr = _basis.transpose() * dv;
+		Vector zr = _basis.transpose() * z;
+		Eigen::HouseholderQR<Eigen::Matrix<real, Eigen::Dynamic, Eigen::Dynamic>> qr(dr);
+		Vector mr = qr.solve(zr);
+		if (!mr.allFinite()) break;
+		q -= mr;
+		s = s0 + _basis * q;
+		stalled = mr.norm() <= 1e-12 * q.norm();
+	}
+
+	if (converged)
+	{
+		_reduced_count++;
+		return snapshot->get_solution(&s);
+	}
+
+	//Basis does not capture this load case
+	_full_count++;
+	Solution start = snapshot->get_solution(&s);
+	return snapshot->solve(options, nmode > 0 ? &start : nullptr);
+}
+
+p6::uint p6::ReducedModel::get_reduced_count() const noexcept
+{
+	return _reduced_count;
+}
+
+p6::uint p6::ReducedModel::get_full_count() const noexcept
+{
+	return _full_count;
+}
@@ -0,0 +1,84 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#include "../header/p6_sizing.hpp"
+#include "../header/p6_construction.hpp"
+#include "../header/p6_math.hpp"
+#include <cassert>
+#include <chrono>
+#include <algorithm>
+
+p6::Sizing::Sizing(Construction *construction, const std::vector<real> *stress_limit, real min_area, real tolerance, uint max_iterations)
+{
+	assert(stress_limit->size() == construction->get_material_count());
+	assert(min_area > 0.0);
+	Solution solution;
+	bool warm = false;
+	for (uint iteration = 0; iteration < max_iterations; iteration++)
+	{
+		//Simulating current design, starting from previous design's state
+		Snapshot snapshot = construction->snapshot();
+		Snapshot::Options options = construction->get_options();
+		auto begin = std::chrono::steady_clock::now();
+		solution = snapshot.solve(&options, warm ? &solution : nullptr);
+		_solver_time += std::chrono::duration<real>(std::chrono::steady_clock::now() - begin).count();
+		warm = true;
+
+		//Stress ratios, sticks at minimal area only need to be below limit
+		Iteration record;
+		record.volume = 0.0;
+		record.max_ratio = 0.0;
+		record.solver_iterations = solution.get_iterations();
+		std::vector<real> ratio(construction->get_stick_count());
+		_converged = true;
+		for (uint i = 0; i < construction->get_stick_count(); i++)
+		{
+			uint node[2];
+			snapshot.get_stick_node(i, node);
+			real area = construction->get_stick_area(i);
+			record.volume += area * snapshot.get_node_coord(node[0]).distance(snapshot.get_node_coord(node[1]));
+			ratio[i] = abs(solution.get_stick_force(i)) / area / stress_limit->at(construction->get_stick_material(i));
+			record.max_ratio = std::max(record.max_ratio, ratio[i]);
+			bool minimal = area <= min_area * (1.0 + tolerance);
+			if (minimal ? ratio[i] > 1.0 + tolerance : abs(ratio[i] - 1.0) > tolerance) _converged = false;
+		}
+		_history.push_back(record);
+		if (_converged) break;
+
+		//Resizing
+		for (uint i = 0; i < construction->get_stick_count(); i++)
+		{
+			real area = construction->get_stick_area(i);
+			real resized = std::min(std::max(area * ratio[i], 0.5 * area), 2.0 * area);
+			construction->set_stick_area(i, std::max(resized, min_area));
+		}
+	}
+}
+
+bool p6::Sizing::converged() const noexcept
+{
+	return _converged;
+}
+
+p6::uint p6::Sizing::get_iteration_count() const noexcept
+{
+	return _history.size();
+}
+
+p6::Sizing::Iteration p6::Sizing::get_iteration(uint index) const noexcept
+{
+	return _history[index];
+}
+
+p6::real p6::Sizing::get_solver_time() const noexcept
+{
+	return _solver_time;
+}
@@ -0,0 +1,1554 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+#include "../header/p6_snapshot.hpp"
+#include "../header/p6_construction.hpp"
+#include "../header/p6_stability.hpp"
+#include "../header/p6_symmetry.hpp"
+#include "../header/p6_convergence_monitor.hpp"
+#include "../header/p6_dispatcher.hpp"
+#include "../header/p6_math.hpp"
+#include "../header/p6_block_sparse_matrix.hpp"
+#include "../header/p6_file.hpp"
+#include "../header/p6_domain_decomposition.hpp"
+#include <stdexcept>
+#include <cassert>
+#include <limits>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+#endif
+
+p6::uint p6::Snapshot::_node_equation_fx(uint free2d) const noexcept
+{
+	assert(free2d < _nfree2d);
+	return 2 * free2d;
+}
+
+p6::uint p6::Snapshot::_node_equation_fy(uint free2d) const noexcept
+{
+	assert(free2d < _nfree2d);
+	return 2 * free2d + 1;
+}
+
+p6::uint p6::Snapshot::_node_equation_fr(uint free1d) const noexcept
+{
+	assert(free1d < _nfree1d);
+	return 2 * _nfree2d + free1d;
+}
+
+p6::uint p6::Snapshot::_equation_number() const noexcept
+{
+	return 2 * _nfree2d + _nfree1d;
+}
+
+p6::uint p6::Snapshot::_node_variable_x(uint free2d) const noexcept
+{
+	assert(free2d < _nfree2d);
+	return 2 * free2d;
+}
+
+p6::uint p6::Snapshot::_node_variable_y(uint free2d) const noexcept
+{
+	assert(free2d < _nfree2d);
+	return 2 * free2d + 1;
+}
+
+p6::uint p6::Snapshot::_node_variable_r(uint free1d) const noexcept
+{
+	assert(free1d < _nfree1d);
+	return 2 * _nfree2d + free1d;
+}
+
+p6::uint p6::Snapshot::_variable_number() const noexcept
+{
+	return 2 * _nfree2d + _nfree1d;
+}
+
+void p6::Snapshot::_create_map() noexcept
+{
+	_nfree2d = 0;
+	_nfree1d = 0;
+	for (uint i = 0; i < _node.size(); i++)
+	{
+		if (_node[i].freedom == 1)
+		{
+			_node[i].free = _nfree1d;
+			_nfree1d++;
+		}
+		else if (_node[i].freedom == 2)
+		{
+			_node[i].free = _nfree2d;
+			_nfree2d++;
+		}
+		else _node[i].free = (uint)-1;
+	}
+}
+
+p6::real p6::Snapshot::_get_tolerance() const noexcept
+{
+	real minforce = std::numeric_limits<real>::infinity();
+	for (uint i = 0; i < _force.size(); i++)
+	{
+		real newforce = _force[i].direction.norm();
+		if (newforce < minforce) minforce = newforce;
+	}
+
+	//Condensed forces may contain rounding noise, so largest one represents superelement's load
+	for (uint i = 0; i < _superelement.size(); i++)
+	{
+		real newforce = 0.0;
+		for (uint j = 0; j < _superelement[i].node.size(); j++)
+		{
+			real norm = Coord(_superelement[i].force[2 * j], _superelement[i].force[2 * j + 1]).norm();
+			if (norm > newforce) newforce = norm;
+		}
+		if (newforce > 0.0 && newforce < minforce) minforce = newforce;
+	}
+	return minforce / 1000.0;
+}
+
+void p6::Snapshot::_get_node_equation(uint node, uint equation[2]) const noexcept
+{
+	if (_node[node].freedom == 1)
+	{
+		equation[0] = _node_equation_fr(_node[node].free);
+		equation[1] = (uint)-1;
+	}
+	else if (_node[node].freedom == 2)
+	{
+		equation[0] = _node_equation_fx(_node[node].free);
+		equation[1] = _node_equation_fy(_node[node].free);
+	}
+	else
+	{
+		equation[0] = (uint)-1;
+		equation[1] = (uint)-1;
+	}
+}
+
+void p6::Snapshot::_create_vectors(Vector *s, Vector *z, Vector *m, BlockSparseMatrix *d) const noexcept
+{
+	get_initial_state(s);
+	z->resize(_equation_number());
+	z->setZero();
+	m->resize(_equation_number());
+	m->setZero();
+	_create_pattern(d);
+}
+
+p6::uint p6::Snapshot::_node_block(uint node) const noexcept
+{
+	if (_node[node].freedom == 1) return _nfree2d + _node[node].free;
+	else if (_node[node].freedom == 2) return _node[node].free;
+	else return (uint)-1;
+}
+
+void p6::Snapshot::_create_pattern(BlockSparseMatrix *d) const noexcept
+{
+	//Fully free nodes give 2x2 blocks and go first, like their variables, rail nodes give 1x1 blocks
+	std::vector<uint> size(_nfree2d + _nfree1d, 1);
+	for (uint i = 0; i < _nfree2d; i++) size[i] = 2;
+
+	//Sticks couple their nodes, superelements couple all their nodes
+	std::vector<uint> pattern;
+	for (uint i = 0; i < _stick.size(); i++)
+	{
+		pattern.push_back(_node_block(_stick[i].node[0]));
+		pattern.push_back(_node_block(_stick[i].node[1]));
+	}
+	for (uint i = 0; i < _superelement.size(); i++)
+	{
+		const std::vector<uint> *node = &_superelement[i].node;
+		for (uint j = 0; j < node->size(); j++)
+		{
+			for (uint k = 0; k < j; k++)
+			{
+				pattern.push_back(_node_block(node->at(j)));
+				pattern.push_back(_node_block(node->at(k)));
+			}
+		}
+	}
+	d->create(size, pattern);
+}
+
+void p6::Snapshot::_set_z_to_external_forces(Vector *z, real factor) const noexcept
+{
+	z->setZero();
+	for (uint i = 0; i < _force.size(); i++)
+	{
+		const Node *node = &_node[_force[i].node];
+		Coord direction = _force[i].direction * factor;
+		if (node->freedom == 1)
+		{
+			(*z)(_node_equation_fr(node->free)) += direction.x * cos(node->angle) + direction.y * sin(node->angle);
+		}
+		else if (node->freedom == 2)
+		{
+			(*z)(_node_equation_fx(node->free)) += direction.x;
+			(*z)(_node_equation_fy(node->free)) += direction.y;
+		}
+	}
+}
+
+void p6::Snapshot::_set_d_to_zero(BlockSparseMatrix *d) const noexcept
+{
+	//Only entries within pattern are stored
+	d->set_zero();
+}
+
+p6::Coord p6::Snapshot::_get_coord(uint node, const Vector *s) const noexcept
+{
+	const Node *n = &_node[node];
+	if (n->freedom == 1)
+	{
+		return n->coord + Coord(cos(n->angle), sin(n->angle)) * (*s)(_node_variable_r(n->free));
+	}
+	else if (n->freedom == 2)
+	{
+		return Coord((*s)(_node_variable_x(n->free)), (*s)(_node_variable_y(n->free)));
+	}
+	else return n->coord;
+}
+
+p6::Coord p6::Snapshot::_get_delta(uint stick, const Vector *s) const noexcept
+{
+	const uint *node = _stick[stick].node;
+	return _get_coord(node[1], s) - _get_coord(node[0], s);
+}
+
+void p6::Snapshot::_modify_z_with_stick_force(uint stick, const Vector *s, Vector *z) const noexcept
+{
+	const Stick *st = &_stick[stick];
+	Coord delta = _get_delta(stick, s);
+	real length = delta.norm();
+	real force = st->area * st->material->stress(length / st->initial_length - 1.0);
+
+	for (uint i = 0; i < 2; i++)
+	{
+		const Node *n = &_node[st->node[i]];
+		real sign = i == 0 ? 1.0 : -1.0;
+		if (n->freedom == 1)
+		{
+			(*z)(_node_equation_fr(n->free)) +=
+				cos(n->angle) * sign * force * delta.x / length +
+				sin(n->angle) * sign * force * delta.y / length;
+		}
+		else if (n->freedom == 2)
+		{
+			(*z)(_node_equation_fx(n->free)) += sign * force * delta.x / length;
+			(*z)(_node_equation_fy(n->free)) += sign * force * delta.y / length;
+		}
+	}
+}
+
+void p6::Snapshot::_create_scatter(const BlockSparseMatrix *d, std::vector<uint> *scatter) const noexcept
+{
+	//Entry of equation a of own node and variable b of other node is stored at (2 * own + a) * 4 + 2 * other + b
+	//Absent entries (fixed nodes, second variable of rail node) are -1
+	scatter->assign(16 * _stick.size(), (uint)-1);
+	for (uint i = 0; i < _stick.size(); i++)
+	{
+		uint *offset = &scatter->at(16 * i);
+		for (uint own = 0; own < 2; own++)
+		{
+			uint equation[2];
+			_get_node_equation(_stick[i].node[own], equation);
+			for (uint other = 0; other < 2; other++)
+			{
+				uint variable[2];
+				get_node_variable(_stick[i].node[other], variable);
+				for (uint a = 0; a < 2; a++)
+				{
+					for (uint b = 0; b < 2; b++)
+					{
+						if (equation[a] != (uint)-1 && variable[b] != (uint)-1)
+							offset[(2 * own + a) * 4 + 2 * other + b] = d->find(equation[a], variable[b]);
+					}
+				}
+			}
+		}
+	}
+}
+
+void p6::Snapshot::_get_stick_derivative(uint stick, const Vector *s, real derivative[16]) const noexcept
+{
+	const Stick *st = &_stick[stick];
+	Coord delta = _get_delta(stick, s);
+	real length = delta.norm();
+	real strain = length / st->initial_length - 1.0;
+	real stress, stress_derivative;
+	st->material->calculate(strain, &stress, &stress_derivative);
+	real force = st->area * stress;
+	real stiffness = st->area * stress_derivative / st->initial_length;
+
+	//Force on first node changes by K * (variation of second node - variation of first node)
+	//K = stiffness * n * n^T + force / length * (I - n * n^T)
+	Coord direction = delta / length;
+	real k[2][2];
+	k[0][0] = stiffness * direction.x * direction.x + force / length * (1.0 - direction.x * direction.x);
+	k[0][1] = k[1][0] = (stiffness - force / length) * direction.x * direction.y;
+	k[1][1] = stiffness * direction.y * direction.y + force / length * (1.0 - direction.y * direction.y);
+
+	//Equations and variables of node on rail are projections on rail
+	Coord projection[2][2];
+	for (uint i = 0; i < 2; i++)
+	{
+		const Node *node = &_node[st->node[i]];
+		if (node->freedom == 1) projection[i][0] = projection[i][1] = Coord(cos(node->angle), sin(node->angle));
+		else { projection[i][0] = Coord(1.0, 0.0); projection[i][1] = Coord(0.0, 1.0); }
+	}
+
+	//Own variables give -K, other's give K
+	for (uint own = 0; own < 2; own++)
+	{
+		for (uint other = 0; other < 2; other++)
+		{
+			real sign = (own == other) ? -1.0 : 1.0;
+			for (uint a = 0; a < 2; a++)
+			{
+				Coord row = projection[own][a];
+				for (uint b = 0; b < 2; b++)
+				{
+					Coord column = projection[other][b];
+					derivative[(2 * own + a) * 4 + 2 * other + b] = sign * (
+						row.x * (k[0][0] * column.x + k[0][1] * column.y) +
+						row.y * (k[1][0] * column.x + k[1][1] * column.y));
+				}
+			}
+		}
+	}
+}
+
+void p6::Snapshot::_modify_d_with_stick_force(uint stick, const Vector *s, const uint *scatter, BlockSparseMatrix *d) const noexcept
+{
+	//Assembling is pure indexed addition
+	real derivative[16];
+	_get_stick_derivative(stick, s, derivative);
+	const uint *offset = &scatter[16 * stick];
+	for (uint i = 0; i < 16; i++)
+	{
+		if (offset[i] != (uint)-1) d->value(offset[i]) += derivative[i];
+	}
+}
+
+void p6::Snapshot::_reassemble_d_with_stick_force(uint stick, const Vector *s, const uint *scatter, real assembled[16], BlockSparseMatrix *d) const noexcept
+{
+	real derivative[16];
+	_get_stick_derivative(stick, s, derivative);
+	const uint *offset = &scatter[16 * stick];
+	for (uint i = 0; i < 16; i++)
+	{
+		if (offset[i] != (uint)-1) d->value(offset[i]) += derivative[i] - assembled[i];
+		assembled[i] = derivative[i];
+	}
+}
+
+void p6::Snapshot::_modify_z_with_superelement(uint superelement, const Vector *s, real factor, Vector *z) const noexcept
+{
+	const Superelement *se = &_superelement[superelement];
+	uint nnode = se->node.size();
+
+	//Boundary displacements
+	std::vector<Coord> displacement(nnode);
+	for (uint i = 0; i < nnode; i++) displacement[i] = _get_coord(se->node[i], s) - _node[se->node[i]].coord;
+
+	for (uint i = 0; i < nnode; i++)
+	{
+		const Node *n = &_node[se->node[i]];
+		if (n->freedom == 0) continue;
+
+		//Force of linearized block on node
+		Coord force(se->force[2 * i] * factor, se->force[2 * i + 1] * factor);
+		for (uint j = 0; j < nnode; j++)
+		{
+			force.x += se->tangent[(2 * i) * 2 * nnode + 2 * j] * displacement[j].x + se->tangent[(2 * i) * 2 * nnode + 2 * j + 1] * displacement[j].y;
+			force.y += se->tangent[(2 * i + 1) * 2 * nnode + 2 * j] * displacement[j].x + se->tangent[(2 * i + 1) * 2 * nnode + 2 * j + 1] * displacement[j].y;
+		}
+
+		if (n->freedom == 1)
+		{
+			(*z)(_node_equation_fr(n->free)) += force.x * cos(n->angle) + force.y * sin(n->angle);
+		}
+		else
+		{
+			(*z)(_node_equation_fx(n->free)) += force.x;
+			(*z)(_node_equation_fy(n->free)) += force.y;
+		}
+	}
+}
+
+void p6::Snapshot::_modify_d_with_superelement(uint superelement, BlockSparseMatrix *d) const noexcept
+{
+	const Superelement *se = &_superelement[superelement];
+	uint nnode = se->node.size();
+	for (uint i = 0; i < nnode; i++)
+	{
+		const Node *own = &_node[se->node[i]];
+		if (own->freedom == 0) continue;
+		uint equation[2];
+		_get_node_equation(se->node[i], equation);
+
+		for (uint j = 0; j < nnode; j++)
+		{
+			const Node *other = &_node[se->node[j]];
+			if (other->freedom == 0) continue;
+			uint variable[2];
+			get_node_variable(se->node[j], variable);
+
+			//Block of tangent, projected on rails if needed
+			real block[2][2];
+			for (uint a = 0; a < 2; a++)
+			{
+				for (uint b = 0; b < 2; b++) block[a][b] = se->tangent[(2 * i + a) * 2 * nnode + 2 * j + b];
+			}
+			if (own->freedom == 1)
+			{
+				for (uint b = 0; b < 2; b++) block[0][b] = block[0][b] * cos(own->angle) + block[1][b] * sin(own->angle);
+			}
+			if (other->freedom == 1)
+			{
+				for (uint a = 0; a < 2; a++) block[a][0] = block[a][0] * cos(other->angle) + block[a][1] * sin(other->angle);
+			}
+
+			for (uint a = 0; a < 2; a++)
+			{
+				if (equation[a] == (uint)-1) continue;
+				for (uint b = 0; b < 2; b++)
+				{
+					if (variable[b] != (uint)-1) d->at(equation[a], variable[b]) += block[a][b];
+				}
+			}
+		}
+	}
+}
+
+p6::Coord p6::Snapshot::_get_variation(uint node, const Vector *v) const noexcept
+{
+	const Node *n = &_node[node];
+	if (n->freedom == 1)
+	{
+		return Coord(cos(n->angle), sin(n->angle)) * (*v)(_node_variable_r(n->free));
+	}
+	else if (n->freedom == 2)
+	{
+		return Coord((*v)(_node_variable_x(n->free)), (*v)(_node_variable_y(n->free)));
+	}
+	else return Coord(0.0, 0.0);
+}
+
+void p6::Snapshot::_add_node_force(uint node, Coord force, Vector *z) const noexcept
+{
+	const Node *n = &_node[node];
+	if (n->freedom == 1)
+	{
+		(*z)(_node_equation_fr(n->free)) += force.x * cos(n->angle) + force.y * sin(n->angle);
+	}
+	else if (n->freedom == 2)
+	{
+		(*z)(_node_equation_fx(n->free)) += force.x;
+		(*z)(_node_equation_fy(n->free)) += force.y;
+	}
+}
+
+void p6::Snapshot::_multiply_d_with_stick_force(uint stick, const Vector *s, const Vector *v, Vector *dv) const noexcept
+{
+	const Stick *st = &_stick[stick];
+	Coord delta = _get_delta(stick, s);
+	real length = delta.norm();
+	real stress, derivative;
+	st->material->calculate(length / st->initial_length - 1.0, &stress, &derivative);
+	real force = st->area * stress;
+	real stiffness = st->area * derivative / st->initial_length;
+
+	//Force on first node changes by K * variation of delta, where K = stiffness * n * n^T + force / length * (I - n * n^T)
+	Coord direction = delta / length;
+	Coord variation = _get_variation(st->node[1], v) - _get_variation(st->node[0], v);
+	real along = direction.x * variation.x + direction.y * variation.y;
+	Coord variation_force = direction * (stiffness * along) + (variation - direction * along) * (force / length);
+	_add_node_force(st->node[0], variation_force, dv);
+	_add_node_force(st->node[1], variation_force * (-1.0), dv);
+}
+
+void p6::Snapshot::_multiply_d_with_superelement(uint superelement, const Vector *v, Vector *dv) const noexcept
+{
+	const Superelement *se = &_superelement[superelement];
+	uint nnode = se->node.size();
+	std::vector<Coord> variation(nnode);
+	for (uint i = 0; i < nnode; i++) variation[i] = _get_variation(se->node[i], v);
+	for (uint i = 0; i < nnode; i++)
+	{
+		Coord force(0.0, 0.0);
+		for (uint j = 0; j < nnode; j++)
+		{
+			force.x += se->tangent[(2 * i) * 2 * nnode + 2 * j] * variation[j].x + se->tangent[(2 * i) * 2 * nnode + 2 * j + 1] * variation[j].y;
+			force.y += se->tangent[(2 * i + 1) * 2 * nnode + 2 * j] * variation[j].x + se->tangent[(2 * i + 1) * 2 * nnode + 2 * j + 1] * variation[j].y;
+		}
+		_add_node_force(se->node[i], force, dv);
+	}
+}
+
+void p6::Snapshot::_modify_diagonal_with_stick_force(uint stick, const Vector *s, Vector *diagonal) const noexcept
+{
+	const Stick *st = &_stick[stick];
+	Coord delta = _get_delta(stick, s);
+	real length = delta.norm();
+	real stress, derivative;
+	st->material->calculate(length / st->initial_length - 1.0, &stress, &derivative);
+	real force = st->area * stress;
+	real stiffness = st->area * derivative / st->initial_length;
+	Coord direction = delta / length;
+
+	//Both nodes get -K on their own coordinates
+	for (uint i = 0; i < 2; i++)
+	{
+		const Node *n = &_node[st->node[i]];
+		if (n->freedom == 1)
+		{
+			real along = direction.x * cos(n->angle) + direction.y * sin(n->angle);
+			(*diagonal)(_node_variable_r(n->free)) -= stiffness * sqr(along) + force / length * (1.0 - sqr(along));
+		}
+		else if (n->freedom == 2)
+		{
+			(*diagonal)(_node_variable_x(n->free)) -= stiffness * sqr(direction.x) + force / length * (1.0 - sqr(direction.x));
+			(*diagonal)(_node_variable_y(n->free)) -= stiffness * sqr(direction.y) + force / length * (1.0 - sqr(direction.y));
+		}
+	}
+}
+
+void p6::Snapshot::_modify_diagonal_with_superelement(uint superelement, Vector *diagonal) const noexcept
+{
+	const Superelement *se = &_superelement[superelement];
+	uint nvariable = se->force.size();
+	for (uint i = 0; i < se->node.size(); i++)
+	{
+		const Node *n = &_node[se->node[i]];
+		real xx = se->tangent[(2 * i) * nvariable + 2 * i], xy = se->tangent[(2 * i) * nvariable + 2 * i + 1];
+		real yx = se->tangent[(2 * i + 1) * nvariable + 2 * i], yy = se->tangent[(2 * i + 1) * nvariable + 2 * i + 1];
+		if (n->freedom == 1)
+		{
+			real c = cos(n->angle), s = sin(n->angle);
+			(*diagonal)(_node_variable_r(n->free)) += c * (xx * c + xy * s) + s * (yx * c + yy * s);
+		}
+		else if (n->freedom == 2)
+		{
+			(*diagonal)(_node_variable_x(n->free)) += xx;
+			(*diagonal)(_node_variable_y(n->free)) += yy;
+		}
+	}
+}
+
+void p6::Snapshot::_multiply_d(const Vector *s, const Vector *v, Vector *dv) const noexcept
+{
+	dv->resize(_equation_number());
+	dv->setZero();
+	for (uint i = 0; i < _stick.size(); i++) _multiply_d_with_stick_force(i, s, v, dv);
+	for (uint i = 0; i < _superelement.size(); i++) _multiply_d_with_superelement(i, v, dv);
+}
+
+p6::uint p6::Snapshot::_solve_matrix_free(const Vector *s, const Vector *z, const Options *options, Vector *m) const noexcept
+{
+	uint n = _variable_number();
+	m->resize(n);
+	m->setZero();
+	real znorm = z->norm();
+	if (n == 0 || znorm == 0.0) return 0;
+
+	//Jacobi preconditioner, applied from the right
+	Vector diagonal(n);
+	diagonal.setZero();
+	for (uint i = 0; i < _stick.size(); i++) _modify_diagonal_with_stick_force(i, s, &diagonal);
+	for (uint i = 0; i < _superelement.size(); i++) _modify_diagonal_with_superelement(i, &diagonal);
+	for (uint i = 0; i < n; i++)
+	{
+		if (diagonal(i) == 0.0) diagonal(i) = 1.0;
+	}
+
+	uint restart = std::min(options->krylov_restart, n);
+	Matrix basis(n, restart + 1);
+	Matrix hessenberg(restart + 1, restart);
+	Vector g(restart + 1), rotation_cos(restart), rotation_sin(restart), work, preconditioned;
+	uint iterations = 0;
+	while (iterations < options->krylov_iterations)
+	{
+		//Residual of current approximation
+		_multiply_d(s, m, &work);
+		work = *z - work;
+		real beta = work.norm();
+		if (beta <= options->krylov_tolerance * znorm) break;
+		basis.col(0) = work / beta;
+		g.setZero();
+		g(0) = beta;
+		hessenberg.setZero();
+
+		//Arnoldi process with Givens rotations of Hessenberg matrix
+		uint k = 0;
+		while (k < restart && iterations < options->krylov_iterations)
+		{
+			iterations++;
+			preconditioned = basis.col(k).cwiseQuotient(diagonal);
+			_multiply_d(s, &preconditioned, &work);
+			for (uint j = 0; j <= k; j++)
+			{
+				hessenberg(j, k) = basis.col(j).dot(work);
+				work -= hessenberg(j, k) * basis.col(j);
+			}
+			hessenberg(k + 1, k) = work.norm();
+			bool breakdown = hessenberg(k + 1, k) == 0.0;
+			if (!breakdown) basis.col(k + 1) = work / hessenberg(k + 1, k);
+
+			for (uint j = 0; j < k; j++)
+			{
+				real upper = rotation_cos(j) * hessenberg(j, k) + rotation_sin(j) * hessenberg(j + 1, k);
+				hessenberg(j + 1, k) = -rotation_sin(j) * hessenberg(j, k) + rotation_cos(j) * hessenberg(j + 1, k);
+				hessenberg(j, k) = upper;
+			}
+			real norm = sqrt(sqr(hessenberg(k, k)) + sqr(hessenberg(k + 1, k)));
+			rotation_cos(k) = hessenberg(k, k) / norm;
+			rotation_sin(k) = hessenberg(k + 1, k) / norm;
+			hessenberg(k, k) = norm;
+			hessenberg(k + 1, k) = 0.0;
+			g(k + 1) = -rotation_sin(k) * g(k);
+			g(k) = rotation_cos(k) * g(k);
+			k++;
+			if (breakdown || abs(g(k)) <= options->krylov_tolerance * znorm) break;
+		}
+
+		//Updating approximation with least-squares solution in Krylov subspace
+		Vector y = hessenberg.topLeftCorner(k, k).triangularView<Eigen::Upper>().solve(g.head(k));
+		preconditioned = basis.leftCols(k) * y;
+		*m += preconditioned.cwiseQuotient(diagonal);
+	}
+	return iterations;
+}
+
+p6::real p6::Snapshot::_get_residuum(const Vector *z) const noexcept
+{
+	real error = 0.0;
+	for (int i = 0; i < z->rows(); i++)
+	{
+		real newabs = abs((*z)(i));
+		if (newabs > error) error = newabs;
+	}
+	return error;
+}
+
+p6::real p6::Snapshot::_get_relative_residuum(const Vector *s, const Vector *z) const noexcept
+{
+	//Every equation is compared with sum of magnitudes of forces acting in it
+	Vector scale(_equation_number());
+	scale.setZero();
+	for (uint i = 0; i < _stick.size(); i++)
+	{
+		const Stick *st = &_stick[i];
+		real force = abs(st->area * st->material->stress(_get_delta(i, s).norm() / st->initial_length - 1.0));
+		for (uint j = 0; j < 2; j++)
+		{
+			uint equation[2];
+			_get_node_equation(st->node[j], equation);
+			for (uint k = 0; k < 2; k++) { if (equation[k] != (uint)-1) scale(equation[k]) += force; }
+		}
+	}
+	for (uint i = 0; i < _force.size(); i++)
+	{
+		uint equation[2];
+		_get_node_equation(_force[i].node, equation);
+		for (uint k = 0; k < 2; k++) { if (equation[k] != (uint)-1) scale(equation[k]) += _force[i].direction.norm(); }
+	}
+	for (uint i = 0; i < _superelement.size(); i++)
+	{
+		const Superelement *se = &_superelement[i];
+		uint nnode = se->node.size();
+		for (uint j = 0; j < nnode; j++)
+		{
+			real force = Coord(se->force[2 * j], se->force[2 * j + 1]).norm();
+			for (uint l = 0; l < nnode; l++)
+			{
+				real displacement = (_get_coord(se->node[l], s) - _node[se->node[l]].coord).norm();
+				for (uint a = 0; a < 2; a++)
+				{
+					for (uint b = 0; b < 2; b++) force += abs(se->tangent[(2 * j + a) * 2 * nnode + 2 * l + b]) * displacement;
+				}
+			}
+			uint equation[2];
+			_get_node_equation(se->node[j], equation);
+			for (uint k = 0; k < 2; k++) { if (equation[k] != (uint)-1) scale(equation[k]) += force; }
+		}
+	}
+
+	//Equations without forces are compared with largest force
+	real floor = 1e-12 * (scale.size() > 0 ? scale.maxCoeff() : 0.0);
+	real error = 0.0;
+	for (int i = 0; i < z->rows(); i++)
+	{
+		if (abs((*z)(i)) == 0.0) continue;
+		real newerror = abs((*z)(i)) / std::max(scale(i), floor);
+		if (newerror > error) error = newerror;
+	}
+	return error;
+}
+
+p6::real p6::Snapshot::_get_rounding_residuum(const Vector *s, const Vector *z) const noexcept
+{
+	//Force of stick is calculated from coordinates rounded to epsilon relative to their magnitude
+	const real epsilon = std::numeric_limits<real>::epsilon();
+	Vector scale(_equation_number());
+	scale.setZero();
+	for (uint i = 0; i < _stick.size(); i++)
+	{
+		const Stick *st = &_stick[i];
+		real strain = _get_delta(i, s).norm() / st->initial_length - 1.0;
+		real magnitude = std::max(_get_coord(st->node[0], s).norm(), _get_coord(st->node[1], s).norm());
+		real rounding = epsilon * (abs(st->area * st->material->stress(strain))
+			+ abs(st->area * st->material->derivative(strain)) / st->initial_length * magnitude);
+		for (uint j = 0; j < 2; j++)
+		{
+			uint equation[2];
+			_get_node_equation(st->node[j], equation);
+			for (uint k = 0; k < 2; k++) { if (equation[k] != (uint)-1) scale(equation[k]) += rounding; }
+		}
+	}
+	for (uint i = 0; i < _superelement.size(); i++)
+	{
+		const Superelement *se = &_superelement[i];
+		uint nnode = se->node.size();
+		for (uint j = 0; j < nnode; j++)
+		{
+			real rounding = 0.0;
+			for (uint l = 0; l < nnode; l++)
+			{
+				real magnitude = _get_coord(se->node[l], s).norm();
+				for (uint a = 0; a < 2; a++)
+				{
+					for (uint b = 0; b < 2; b++) rounding += epsilon * abs(se->tangent[(2 * j + a) * 2 * nnode + 2 * l + b]) * magnitude;
+				}
+			}
+			uint equation[2];
+			_get_node_equation(se->node[j], equation);
+			for (uint k = 0; k < 2; k++) { if (equation[k] != (uint)-1) scale(equation[k]) += rounding; }
+		}
+	}
+
+	real error = 0.0;
+	for (int i = 0; i < z->rows(); i++)
+	{
+		if (abs((*z)(i)) == 0.0) continue;
+		if (scale(i) == 0.0) return std::numeric_limits<real>::infinity();
+		real newerror = abs((*z)(i)) / scale(i);
+		if (newerror > error) error = newerror;
+	}
+	return error;
+}
+
+p6::real p6::Snapshot::_get_relative_modification(const Vector *m) const noexcept
+{
+	real length = std::numeric_limits<real>::infinity();
+	for (uint i = 0; i < _stick.size(); i++) length = std::min(length, _stick[i].initial_length);
+	if (_stick.empty() || length == 0.0) return std::numeric_limits<real>::infinity();
+	real modification = 0.0;
+	for (int i = 0; i < m->rows(); i++) modification = std::max(modification, abs((*m)(i)));
+	return modification / length;
+}
+
+bool p6::Snapshot::_is_adequate(const Vector *m, const Vector *s) const noexcept
+{
+	for (int i = 0; i < m->rows(); i++)
+	{
+		if ((*m)(i) != (*m)(i)) return false;
+	}
+
+	for (uint i = 0; i < _stick.size(); i++)
+	{
+		const uint *node = _stick[i].node;
+		Coord delta = _get_delta(i, s);
+		real length = delta.norm();
+		for (uint j = 0; j < 2; j++)
+		{
+			const Node *n = &_node[node[j]];
+			if (n->freedom == 1)
+			{
+				real modification = abs((*m)(_node_variable_r(n->free)));
+				if (modification > length * 0.01) return false;
+			}
+			else if (n->freedom == 2)
+			{
+				real modification = Coord((*m)(_node_variable_x(n->free)), (*m)(_node_variable_y(n->free))).norm();
+				if (modification > length * 0.01) return false;
+			}
+		}
+	}
+	return true;
+}
+
+p6::real p6::Snapshot::_get_adequate_fraction(const Vector *m, const Vector *s) const noexcept
+{
+	for (int i = 0; i < m->rows(); i++)
+	{
+		if (!std::isfinite((*m)(i))) return 0.0;
+	}
+
+	real fraction = 1.0;
+	for (uint i = 0; i < _stick.size(); i++)
+	{
+		const uint *node = _stick[i].node;
+		Coord delta = _get_delta(i, s);
+		real length = delta.norm();
+		for (uint j = 0; j < 2; j++)
+		{
+			const Node *n = &_node[node[j]];
+			real modification = 0.0;
+			if (n->freedom == 1) modification = abs((*m)(_node_variable_r(n->free)));
+			else if (n->freedom == 2) modification = Coord((*m)(_node_variable_x(n->free)), (*m)(_node_variable_y(n->free))).norm();
+			if (modification * fraction > length * 0.01) fraction = length * 0.01 / modification;
+		}
+	}
+	return fraction;
+}
+
+p6::real p6::Snapshot::_get_flow_coefficient(const Vector *s, const Vector *z) const noexcept
+{
+	real coef = std::numeric_limits<real>::infinity();
+	for (uint i = 0; i < _stick.size(); i++)
+	{
+		const uint *node = _stick[i].node;
+		Coord delta = _get_delta(i, s);
+		real length = delta.norm();
+		real initial_length = _stick[i].initial_length;
+		real strain = length / initial_length - 1.0;
+		real df_dl = _stick[i].area * _stick[i].material->derivative(strain) / initial_length;
+		if (1.0 / df_dl < coef) coef = 1.0 / df_dl;
+
+		for (uint j = 0; j < 2; j++)
+		{
+			const Node *n = &_node[node[j]];
+			if (n->freedom == 1)
+			{
+				real unbalanced_force = abs((*z)(_node_equation_fr(n->free)));
+				if (length / unbalanced_force < coef) coef = length / unbalanced_force;
+			}
+			else if (n->freedom == 2)
+			{
+				real unbalanced_force = Coord((*z)(_node_equation_fx(n->free)), (*z)(_node_equation_fy(n->free))).norm();
+				if (length / unbalanced_force < coef) coef = length / unbalanced_force;
+			}
+		}
+	}
+
+	for (uint i = 0; i < _superelement.size(); i++)
+	{
+		const std::vector<real> *tangent = &_superelement[i].tangent;
+		uint nvariable = _superelement[i].force.size();
+		for (uint j = 0; j < nvariable; j++)
+		{
+			real stiffness = abs(tangent->at(j * nvariable + j));
+			if (1.0 / stiffness < coef) coef = 1.0 / stiffness;
+		}
+	}
+	return coef;
+}
+
+void p6::Snapshot::_apply_state_vector(const Vector *s, Solution *solution) const noexcept
+{
+	solution->_coord.resize(_node.size());
+	for (uint i = 0; i < _node.size(); i++) solution->_coord[i] = _get_coord(i, s);
+
+	solution->_strain.resize(_stick.size());
+	solution->_force.resize(_stick.size());
+	for (uint i = 0; i < _stick.size(); i++)
+	{
+		real strain = _get_delta(i, s).norm() / _stick[i].initial_length - 1.0;
+		solution->_strain[i] = strain;
+		solution->_force[i] = _stick[i].area * _stick[i].material->stress(strain);
+	}
+
+	solution->_state.assign(s->data(), s->data() + s->rows());
+}
+
+p6::Snapshot::Snapshot(const Construction *construction)
+{
+	//Checking if materials are specified
+	for (uint i = 0; i < construction->_stick.size(); i++)
+	{
+		assert(construction->_stick[i].material < construction->_material.size() || construction->_stick[i].material == (uint)-1);
+		if (construction->_stick[i].material == (uint)-1) throw std::runtime_error("Material is not specified");
+	}
+
+	//Copying nodes
+	_node.resize(construction->_node.size());
+	for (uint i = 0; i < _node.size(); i++)
+	{
+		_node[i].freedom = construction->_node[i].freedom;
+		_node[i].angle = construction->_node[i].angle;
+		_node[i].coord = construction->_node[i].coord;
+	}
+
+	//Copying sticks
+	_stick.resize(construction->_stick.size());
+	for (uint i = 0; i < _stick.size(); i++)
+	{
+		_stick[i].node[0] = construction->_stick[i].node[0];
+		_stick[i].node[1] = construction->_stick[i].node[1];
+		_stick[i].material = construction->_material[construction->_stick[i].material];
+		_stick[i].area = construction->_stick[i].area;
+		_stick[i].initial_length = _node[_stick[i].node[0]].coord.distance(_node[_stick[i].node[1]].coord);
+	}
+
+	//Copying forces
+	_force.resize(construction->_force.size());
+	for (uint i = 0; i < _force.size(); i++)
+	{
+		_force[i].node = construction->_force[i].node;
+		_force[i].direction = construction->_force[i].direction;
+	}
+
+	//Copying superelements, blocks are rotated with their first two boundary nodes
+	_superelement.resize(construction->_superelement.size());
+	for (uint i = 0; i < _superelement.size(); i++)
+	{
+		const Construction::Superelement *source = &construction->_superelement[i];
+		const Construction::Block *block = source->block.get();
+		uint nvariable = 2 * source->node.size();
+		real angle = 0.0;
+		if (source->node.size() >= 2)
+		{
+			Coord block_delta = block->coord[1] - block->coord[0];
+			Coord delta = _node[source->node[1]].coord - _node[source->node[0]].coord;
+			angle = atan2(delta.y, delta.x) - atan2(block_delta.y, block_delta.x);
+		}
+		Matrix rotation = Matrix::Zero(nvariable, nvariable);
+		for (uint j = 0; j < source->node.size(); j++)
+		{
+			rotation(2 * j, 2 * j) = cos(angle);
+			rotation(2 * j, 2 * j + 1) = -sin(angle);
+			rotation(2 * j + 1, 2 * j) = sin(angle);
+			rotation(2 * j + 1, 2 * j + 1) = cos(angle);
+		}
+		Matrix tangent(nvariable, nvariable);
+		Vector force(nvariable);
+		for (uint j = 0; j < nvariable; j++)
+		{
+			force(j) = block->force[j];
+			for (uint k = 0; k < nvariable; k++) tangent(j, k) = block->tangent[j * nvariable + k];
+		}
+		tangent = rotation * tangent * rotation.transpose();
+		force = rotation * force;
+
+		_superelement[i].node = source->node;
+		_superelement[i].force.assign(force.data(), force.data() + nvariable);
+		_superelement[i].tangent.resize(nvariable * nvariable);
+		for (uint j = 0; j < nvariable; j++)
+		{
+			for (uint k = 0; k < nvariable; k++) _superelement[i].tangent[j * nvariable + k] = tangent(j, k);
+		}
+	}
+
+	//Creating node-to-free map
+	Stopwatch stopwatch;
+	stopwatch.start(&_statistics.create_map);
+	_create_map();
+	stopwatch.stop();
+}
+
+void p6::Snapshot::_get_response_derivative(const Response *response, const Vector *s, Vector *g, real *area, real *scale) const noexcept
+{
+	g->setZero(_variable_number());
+	*area = 0.0;
+	*scale = 0.0;
+	if (response->type == Response::Type::compliance)
+	{
+		//Compliance is f^T * displacement, variables are displacements or coordinates
+		_set_z_to_external_forces(g, 1.0);
+	}
+	else if (response->type == Response::Type::node_displacement)
+	{
+		_add_node_force(response->index, response->direction, g);
+	}
+	else
+	{
+		//Force is area * stress(|delta| / initial_length - 1)
+		const Stick *st = &_stick[response->index];
+		Coord delta = _get_delta(response->index, s);
+		real length = delta.norm();
+		real stress, derivative;
+		st->material->calculate(length / st->initial_length - 1.0, &stress, &derivative);
+		Coord direction = delta * (st->area * derivative / st->initial_length / length);
+		_add_node_force(st->node[0], direction * -1.0, g);
+		_add_node_force(st->node[1], direction, g);
+		*area = stress;
+		*scale = st->area * stress;
+	}
+}
+
+p6::real p6::Snapshot::_get_stick_work(uint stick, const Vector *s, const Vector *v) const noexcept
+{
+	//First node is pulled towards second in tension
+	const Stick *st = &_stick[stick];
+	Coord delta = _get_delta(stick, s);
+	real length = delta.norm();
+	real force = st->material->stress(length / st->initial_length - 1.0);
+	Coord variation = _get_variation(st->node[0], v) - _get_variation(st->node[1], v);
+	return force * (delta.x * variation.x + delta.y * variation.y) / length;
+}
+
+p6::uint p6::Snapshot::get_node_count() const noexcept
+{
+	return _node.size();
+}
+
+p6::uint p6::Snapshot::get_stick_count() const noexcept
+{
+	return _stick.size();
+}
+
+p6::uint p6::Snapshot::get_force_count() const noexcept
+{
+	return _force.size();
+}
+
+unsigned char p6::Snapshot::get_node_freedom(uint node) const noexcept
+{
+	return _node[node].freedom;
+}
+
+p6::Coord p6::Snapshot::get_node_coord(uint node) const noexcept
+{
+	return _node[node].coord;
+}
+
+p6::real p6::Snapshot::get_node_rail_angle(uint node) const noexcept
+{
+	assert(_node[node].freedom == 1);
+	return _node[node].angle;
+}
+
+void p6::Snapshot::get_stick_node(uint stick, uint node[2]) const noexcept
+{
+	node[0] = _stick[stick].node[0];
+	node[1] = _stick[stick].node[1];
+}
+
+const p6::Material *p6::Snapshot::get_stick_material(uint stick) const noexcept
+{
+	return _stick[stick].material;
+}
+
+p6::real p6::Snapshot::get_stick_area(uint stick) const noexcept
+{
+	return _stick[stick].area;
+}
+
+p6::uint p6::Snapshot::get_force_node(uint force) const noexcept
+{
+	return _force[force].node;
+}
+
+p6::Coord p6::Snapshot::get_force_direction(uint force) const noexcept
+{
+	return _force[force].direction;
+}
+
+p6::uint p6::Snapshot::get_variable_number() const noexcept
+{
+	return _variable_number();
+}
+
+void p6::Snapshot::get_node_variable(uint node, uint variable[2]) const noexcept
+{
+	if (_node[node].freedom == 1)
+	{
+		variable[0] = _node_variable_r(_node[node].free);
+		variable[1] = (uint)-1;
+	}
+	else if (_node[node].freedom == 2)
+	{
+		variable[0] = _node_variable_x(_node[node].free);
+		variable[1] = _node_variable_y(_node[node].free);
+	}
+	else
+	{
+		variable[0] = (uint)-1;
+		variable[1] = (uint)-1;
+	}
+}
+
+p6::uint p6::Snapshot::get_superelement_count() const noexcept
+{
+	return _superelement.size();
+}
+
+p6::uint p6::Snapshot::get_superelement_node_count(uint superelement) const noexcept
+{
+	return _superelement[superelement].node.size();
+}
+
+p6::uint p6::Snapshot::get_superelement_node(uint superelement, uint index) const noexcept
+{
+	return _superelement[superelement].node[index];
+}
+
+void p6::Snapshot::get_initial_state(Vector *s) const noexcept
+{
+	s->resize(_variable_number());
+	for (uint i = 0; i < _node.size(); i++)
+	{
+		if (_node[i].freedom == 1)
+		{
+			(*s)(_node_variable_r(_node[i].free)) = 0.0;
+		}
+		else if (_node[i].freedom == 2)
+		{
+			(*s)(_node_variable_x(_node[i].free)) = _node[i].coord.x;
+			(*s)(_node_variable_y(_node[i].free)) = _node[i].coord.y;
+		}
+	}
+}
+
+void p6::Snapshot::get_state(const Solution *solution, Vector *s) const noexcept
+{
+	assert(solution->get_node_count() == _node.size());
+	s->resize(_variable_number());
+	for (uint i = 0; i < _node.size(); i++)
+	{
+		Coord coord = solution->get_node_coord(i);
+		if (_node[i].freedom == 1)
+		{
+			Coord delta = coord - _node[i].coord;
+			(*s)(_node_variable_r(_node[i].free)) = delta.x * cos(_node[i].angle) + delta.y * sin(_node[i].angle);
+		}
+		else if (_node[i].freedom == 2)
+		{
+			(*s)(_node_variable_x(_node[i].free)) = coord.x;
+			(*s)(_node_variable_y(_node[i].free)) = coord.y;
+		}
+	}
+}
+
+void p6::Snapshot::_get_residual(const Vector *s, real factor, Vector *z) const noexcept
+{
+	z->resize(_equation_number());
+	_set_z_to_external_forces(z, factor);
+	for (uint i = 0; i < _stick.size(); i++) _modify_z_with_stick_force(i, s, z);
+	for (uint i = 0; i < _superelement.size(); i++) _modify_z_with_superelement(i, s, factor, z);
+}
+
+p6::uint p6::Snapshot::_get_map_hash() const noexcept
+{
+	//FNV-1a hash of node-to-free map
+	uint hash = (uint)14695981039346656037ULL;
+	auto add = [&hash](uint value)
+	{
+		for (uint i = 0; i < sizeof(uint); i++) { hash ^= (value >> (8 * i)) & 0xFF; hash *= (uint)1099511628211ULL; }
+	};
+	add(_nfree2d);
+	add(_nfree1d);
+	for (uint i = 0; i < _node.size(); i++)
+	{
+		add(_node[i].freedom);
+		add(_node[i].freedom == 0 ? (uint)-1 : _node[i].free);
+	}
+	return hash;
+}
+
+void p6::Snapshot::_save_checkpoint(const String filepath, uint step, uint steps, uint iterations, const Vector *s) const
+{
+	//Checkpoint is written to temporary file and replaces previous one only when complete, replacement is atomic
+	String temporary = filepath + ".tmp";
+	{
+		OutputFile file(temporary);
+		if (!file.ok()) throw std::runtime_error("File cannot be opened for write");
+		Checkpoint checkpoint;
+		checkpoint.map_hash = _get_map_hash();
+		checkpoint.variables = _variable_number();
+		checkpoint.step = step;
+		checkpoint.steps = steps;
+		checkpoint.iterations = iterations;
+		checkpoint.factor = std::min((real)step, (real)steps) / steps;
+		file.write(&checkpoint, sizeof(Checkpoint));
+		file.write(s->data(), s->size() * sizeof(real));
+	}
+	#ifdef _WIN32
+		if (!MoveFileExA(temporary.c_str(), filepath.c_str(), MOVEFILE_REPLACE_EXISTING)) throw std::runtime_error("File cannot be opened for write");
+	#else
+		if (std::rename(temporary.c_str(), filepath.c_str()) != 0) throw std::runtime_error("File cannot be opened for write");
+	#endif
+}
+
+void p6::Snapshot::get_residual(const Vector *s, Vector *z) const noexcept
+{
+	_get_residual(s, 1.0, z);
+}
+
+void p6::Snapshot::get_tangent(const Vector *s, Matrix *d) const noexcept
+{
+	BlockSparseMatrix sparse;
+	get_tangent(s, &sparse);
+	sparse.to_dense(d);
+}
+
+void p6::Snapshot::get_tangent(const Vector *s, BlockSparseMatrix *d) const noexcept
+{
+	std::vector<uint> scatter;
+	create_tangent(d, &scatter);
+	get_tangent(s, &scatter, d);
+}
+
+void p6::Snapshot::create_tangent(BlockSparseMatrix *d, std::vector<uint> *scatter) const noexcept
+{
+	_create_pattern(d);
+	_create_scatter(d, scatter);
+}
+
+void p6::Snapshot::get_tangent(const Vector *s, const std::vector<uint> *scatter, BlockSparseMatrix *d) const noexcept
+{
+	assert(scatter->size() == 16 * _stick.size());
+	_set_d_to_zero(d);
+	for (uint i = 0; i < _stick.size(); i++) _modify_d_with_stick_force(i, s, scatter->data(), d);
+	for (uint i = 0; i < _superelement.size(); i++) _modify_d_with_superelement(i, d);
+}
+
+p6::Solution p6::Snapshot::get_solution(const Vector *s) const noexcept
+{
+	Solution solution;
+	_apply_state_vector(s, &solution);
+	return solution;
+}
+
+void p6::Snapshot::get_sensitivity(const Solution *solution, const Response *response, std::vector<real> *area, std::vector<real> *modulus) const
+{
+	//Equilibrium z(s, p) = 0 gives dR/dp = partial R/partial p - lambda^T * partial z/partial p, where d^T * lambda = partial R/partial s
+	assert(solution->_state.size() == _variable_number());
+	Vector s = Eigen::Map<const Eigen::Vector<real, Eigen::Dynamic>>(solution->_state.data(), solution->_state.size());
+	BlockSparseMatrix d;
+	get_tangent(&s, &d);
+	Vector g, lambda;
+	real direct_area, direct_scale;
+	_get_response_derivative(response, &s, &g, &direct_area, &direct_scale);
+	if (d.factorize()) d.solve_transposed(&g, &lambda);
+	else
+	{
+		//Envelope factorization has no pivoting, dense QR of transposed matrix handles nearly singular cases
+		Matrix dense;
+		d.to_dense(&dense);
+		Eigen::HouseholderQR<Eigen::Matrix<real, Eigen::Dynamic, Eigen::Dynamic>> qr(dense.transpose());
+		lambda = qr.solve(g);
+	}
+
+	//Stick's forces are proportional to it's area and to scale of stress-strain curve, scale can not be expressed through zero modulus
+	area->resize(_stick.size());
+	modulus->resize(_stick.size());
+	for (uint i = 0; i < _stick.size(); i++)
+	{
+		real work = _get_stick_work(i, &s, &lambda);
+		real d_area = -work;
+		real d_scale = -_stick[i].area * work;
+		if (response->type == Response::Type::stick_force && response->index == i)
+		{
+			d_area += direct_area;
+			d_scale += direct_scale;
+		}
+		real initial_modulus = _stick[i].material->derivative(0.0);
+		(*area)[i] = d_area;
+		(*modulus)[i] = (initial_modulus == 0.0) ? 0.0 : d_scale / initial_modulus;
+	}
+}
+
+p6::Solution p6::Snapshot::solve(const Options *options, const Solution *start) const
+{
+	Options default_options;
+	if (options == nullptr) options = &default_options;
+	if (options->method == Method::automatic)
+	{
+		Dispatcher dispatcher(this, options);
+		return dispatcher.solve(this, start);
+	}
+
+	//Iterations start from initial state or from given solution
+	Vector s;
+	if (start != nullptr)
+	{
+		assert(start->_state.size() == _variable_number());
+		s = Eigen::Map<const Eigen::Vector<real, Eigen::Dynamic>>(start->_state.data(), start->_state.size());
+	}
+	else get_initial_state(&s);
+	return _solve(options, &s, 1, options->load_steps, 0);
+}
+
+p6::Solution p6::Snapshot::resume(const String filepath, const Options *options) const
+{
+	Options default_options;
+	if (options == nullptr) options = &default_options;
+	Options resolved = *options;
+	if (resolved.method == Method::automatic) resolved = Dispatcher(this, options).get_options();
+
+	InputFile file(filepath);
+	if (!file.ok()) throw std::runtime_error("File cannot be opened for read");
+	uint size = file.size();
+	Checkpoint checkpoint, sample;
+	if (size < sizeof(Checkpoint)) throw std::runtime_error("Invalid file format");
+	file.read(&checkpoint, sizeof(Checkpoint));
+	if (memcmp(checkpoint.signature, sample.signature, 8) != 0) throw std::runtime_error("Invalid file format");
+	if (checkpoint.map_hash != _get_map_hash() || checkpoint.variables != _variable_number() || checkpoint.step == 0 || checkpoint.steps == 0)
+		throw std::runtime_error("Checkpoint does not match construction");
+	if (size != sizeof(Checkpoint) + checkpoint.variables * sizeof(real)
+		|| checkpoint.factor != std::min((real)checkpoint.step, (real)checkpoint.steps) / checkpoint.steps)
+		throw std::runtime_error("Checkpoint is damaged");
+	Vector s(checkpoint.variables);
+	file.read(s.data(), checkpoint.variables * sizeof(real));
+	return _solve(&resolved, &s, checkpoint.step, checkpoint.steps, checkpoint.iterations);
+}
+
+p6::Solution p6::Snapshot::_solve(const Options *options, const Vector *start, uint first_step, uint steps, uint iterations) const
+{
+	//Rejecting mechanisms before iterating, construction that is a mechanism only in it's initial position (like sagging string) may still find equilibrium
+	Stability stability(this);
+	if (!stability.combinatorial()) throw std::runtime_error(stability.message());
+
+	//Mirror-symmetric construction stays symmetric, so only half of variables are solved for
+	Symmetry symmetry(this);
+	bool matrix_free = options->method == Method::matrix_free;
+	bool decomposition = options->method == Method::decomposition;
+	bool half = options->method == Method::direct && options->symmetry && symmetry.symmetric();
+
+	//Calculating tolerance
+	real tolerance = _get_tolerance();
+	const real rounding_tolerance = 100.0;	//Unbalanced force relative to rounding error accepted when Newton's modification is negligible
+
+	//Creating vectors and matrixes
+	Vector s;	//State vector
+	Vector z;	//Should-be-zero value
+	Vector m;				//Modification of state vector
+	BlockSparseMatrix d;	//Derivative of should-be-zero value, not used in matrix-free mode
+	Statistics statistics = _statistics;	//Wall time and calls of phases
+	Stopwatch stopwatch;
+	stopwatch.start(&statistics.create_vectors);
+	if (matrix_free) z.resize(_equation_number());
+	else _create_vectors(&s, &z, &m, &d);
+	s = *start;
+	std::vector<uint> scatter;	//Offsets of sticks' derivatives in d
+	if (!matrix_free) _create_scatter(&d, &scatter);
+	stopwatch.stop();
+	DomainDecomposition domains;	//Subdomains of d, used in decomposition mode
+	if (decomposition) domains.create(&d, options->subdomains, options->threads);
+	BlockSparseMatrix dr;	//Reduced derivative T^T * d * T, used in half mode
+	Vector zr, mr;			//Reduced should-be-zero value and modification
+	if (half) symmetry.create_reduced_matrix(&d, &dr);
+
+	//In incremental mode unscaled d and derivatives of every stick are kept between iterations
+	bool incremental = !matrix_free && options->reassembly_threshold > 0.0;
+	std::vector<real> assembled_d;				//Unscaled values of d
+	std::vector<real> assembled_stick;			//Derivatives of each stick as assembled in d
+	std::vector<Coord> assembled_delta;			//Coordinate difference of each stick when it was assembled
+	if (incremental)
+	{
+		assembled_stick.assign(16 * _stick.size(), 0.0);
+		assembled_delta.resize(_stick.size());
+	}
+
+	//Loads are applied in equal steps, monitor aborts hopeless simulations
+	ConvergenceMonitor monitor(options->max_iterations, options->max_time, options->stagnation_iterations);
+	uint krylov_iterations = 0;
+	bool checkpoints = !options->checkpoint_path.empty();
+	auto begin = std::chrono::steady_clock::now();
+	auto last_checkpoint = begin;
+	for (uint step = first_step; step <= steps; step++)
+	{
+		real factor = (real)step / steps;
+		monitor.restart();
+		bool negligible = false;	//Indicator if last Newton's modification was at rounding level
+		while (true)
+		{
+			stopwatch.start(&statistics.assembly);
+			if (matrix_free)
+			{
+				_get_residual(&s, factor, &z);
+			}
+			else if (incremental)
+			{
+				//Only sticks whose ends moved enough since their assembly are reassembled, superelements are linear
+				bool first = assembled_d.empty();
+				_set_z_to_external_forces(&z, factor);
+				if (first) _set_d_to_zero(&d);
+				else d.set_values(&assembled_d);
+				for (uint i = 0; i < _stick.size(); i++)
+				{
+					_modify_z_with_stick_force(i, &s, &z);
+					Coord delta = _get_delta(i, &s);
+					if (first || (delta - assembled_delta[i]).norm() > options->reassembly_threshold * _stick[i].initial_length)
+					{
+						_reassemble_d_with_stick_force(i, &s, scatter.data(), &assembled_stick[16 * i], &d);
+						assembled_delta[i] = delta;
+					}
+				}
+				for (uint i = 0; i < _superelement.size(); i++)
+				{
+					_modify_z_with_superelement(i, &s, factor, &z);
+					if (first) _modify_d_with_superelement(i, &d);
+				}
+				d.get_values(&assembled_d);
+			}
+			else
+			{
+				_set_z_to_external_forces(&z, factor);
+				_set_d_to_zero(&d);
+				for (uint i = 0; i < _stick.size(); i++)
+				{
+					_modify_z_with_stick_force(i, &s, &z);
+					_modify_d_with_stick_force(i, &s, scatter.data(), &d);
+				}
+				for (uint i = 0; i < _superelement.size(); i++)
+				{
+					_modify_z_with_superelement(i, &s, factor, &z);
+					_modify_d_with_superelement(i, &d);
+				}
+			}
+			stopwatch.stop();
+			real error = _get_residuum(&z);
+			if (error < factor * tolerance) break;
+			else if (options->scaling && _get_relative_residuum(&s, &z) < options->relative_tolerance) break;
+			else if (negligible && _get_rounding_residuum(&s, &z) < rounding_tolerance) break;
+			else if (negligible) { monitor.stagnate(); throw ConvergenceError(&monitor); }
+			else if (monitor.check(error) != ConvergenceMonitor::Diagnosis::none) throw ConvergenceError(&monitor);
+			if (checkpoints && std::chrono::duration<real>(std::chrono::steady_clock::now() - last_checkpoint).count() >= options->checkpoint_interval)
+			{
+				_save_checkpoint(options->checkpoint_path, step, steps, iterations, &s);
+				last_checkpoint = std::chrono::steady_clock::now();
+			}
+			stopwatch.start(&statistics.factorization);
+			if (matrix_free)
+			{
+				krylov_iterations += _solve_matrix_free(&s, &z, options, &m);
+			}
+			else
+			{
+				//Half model is (T^T * d * T) * mr = T^T * z with m = T * mr and goes through the same pipeline
+				BlockSparseMatrix *system = &d;
+				Vector *rhs = &z, *modification = &m;
+				if (half)
+				{
+					symmetry.reduce_vector(&z, &zr);
+					symmetry.reduce_matrix(&d, &dr);
+					system = &dr;
+					rhs = &zr;
+					modification = &mr;
+				}
+				//Equilibrated system is (R * d * C) * (C^-1 * m) = R * z
+				Vector row_scale, column_scale, scaled_z = *rhs;
+				if (options->scaling)
+				{
+					system->equilibrate(&row_scale, &column_scale);
+					scaled_z = rhs->cwiseProduct(row_scale);
+				}
+				//Subdomains are factorized in parallel, whole matrix is factorized if some of them is singular
+				bool solved = decomposition && domains.factorize(system);
+				if (solved) domains.solve(&scaled_z, modification);
+				//Single precision factorization is refined against double precision matrix, double precision is used if refinement stalls
+				if (!solved) solved = options->mixed_precision && system->factorize(true) && system->refine(&scaled_z, modification);
+				if (!solved && system->factorize())
+				{
+					system->solve(&scaled_z, modification);
+					solved = true;
+				}
+				if (!solved)
+				{
+					//Envelope factorization has no pivoting, dense QR handles nearly singular cases
+					Matrix dense;
+					system->to_dense(&dense);
+					Eigen::HouseholderQR<Eigen::Matrix<real, Eigen::Dynamic, Eigen::Dynamic>> qr(dense);
+					*modification = qr.solve(scaled_z);
+				}
+				if (options->scaling) *modification = modification->cwiseProduct(column_scale);
+				if (half) symmetry.expand_vector(&mr, &m);
+			}
+			stopwatch.stop();
+			stopwatch.start(&statistics.adequacy);
+			bool adequate = _is_adequate(&m, &s);
+			stopwatch.stop();
+			monitor.add_step(adequate);
+			real step_norm = 0.0;	//Calculated only for observer
+			if (adequate)
+			{
+				s -= m;
+				if (options->observer != nullptr) step_norm = m.norm();
+				if (Statistics::enabled) statistics.newton_steps++;
+			}
+			else
+			{
+				//Construction without stiffness across some sticks (like sagging string) takes Newton's modification shortened to adequate length if it decreases unbalanced force, flow step otherwise
+				stopwatch.start(&statistics.flow);
+				real fraction = stability.geometric() ? 0.0 : _get_adequate_fraction(&m, &s);
+				Vector shortened_s, shortened_z;
+				if (fraction > 0.0)
+				{
+					shortened_s = s - fraction * m;
+					_get_residual(&shortened_s, factor, &shortened_z);
+				}
+				if (fraction > 0.0 && _get_residuum(&shortened_z) < error)
+				{
+					s = shortened_s;
+					stopwatch.stop();
+					if (options->observer != nullptr) step_norm = fraction * m.norm();
+				}
+				else
+				{
+					real coefficient = _get_flow_coefficient(&s, &z);
+					stopwatch.stop();
+					if (half)
+					{
+						Vector p;
+						symmetry.project_vector(&z, &p);
+						s += 0.01 * coefficient * p;
+						if (options->observer != nullptr) step_norm = 0.01 * abs(coefficient) * p.norm();
+					}
+					else
+					{
+						s += 0.01 * coefficient * z;
+						if (options->observer != nullptr) step_norm = 0.01 * abs(coefficient) * z.norm();
+					}
+				}
+				if (Statistics::enabled) statistics.flow_steps++;
+			}
+			iterations++;
+			if (options->observer != nullptr)
+			{
+				Iteration progress;
+				progress.iteration = iterations;
+				progress.step = step;
+				progress.residual = error;
+				progress.newton = adequate;
+				progress.step_norm = step_norm;
+				progress.time = std::chrono::duration<real>(std::chrono::steady_clock::now() - begin).count();
+				options->observer->observe(&progress);
+			}
+			//Newton's modification at rounding level means forces can not be balanced any better, they must be balanced up to their rounding
+			negligible = adequate && options->scaling && _get_relative_modification(&m) < options->relative_tolerance;
+		}
+
+		//Converged state of every load step is saved
+		if (checkpoints)
+		{
+			_save_checkpoint(options->checkpoint_path, step + 1, steps, iterations, &s);
+			last_checkpoint = std::chrono::steady_clock::now();
+		}
+	}
+
+	Solution solution;
+	stopwatch.start(&statistics.apply);
+	_apply_state_vector(&s, &solution);
+	stopwatch.stop();
+	solution._iterations = iterations;
+	solution._krylov_iterations = krylov_iterations;
+	solution._statistics = statistics;
+	if (!stability.geometric()) solution._warning = stability.message();
+	return solution;
+}
@@ -0,0 +1,60 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+#include "../header/p6_solution.hpp"
+#include <cassert>
+
+p6::uint p6::Solution::get_node_count() const noexcept
+{
+	return _coord.size();
+}
+
+p6::uint p6::Solution::get_stick_count() const noexcept
+{
+	return _strain.size();
+}
+
+p6::Coord p6::Solution::get_node_coord(uint node) const noexcept
+{
+	assert(node < _coord.size());
+	return _coord[node];
+}
+
+p6::real p6::Solution::get_stick_strain(uint stick) const noexcept
+{
+	assert(stick < _strain.size());
+	return _strain[stick];
+}
+
+p6::real p6::Solution::get_stick_force(uint stick) const noexcept
+{
+	assert(stick < _force.size());
+	return _force[stick];
+}
+
+p6::uint p6::Solution::get_iterations() const noexcept
+{
+	return _iterations;
+}
+
+p6::uint p6::Solution::get_krylov_iterations() const noexcept
+{
+	return _krylov_iterations;
+}
+
+const p6::Statistics *p6::Solution::get_statistics() const noexcept
+{
+	return &_statistics;
+}
+
+p6::String p6::Solution::get_warning() const
+{
+	return _warning;
+}
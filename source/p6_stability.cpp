@@ -0,0 +1,273 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+#include "../header/p6_stability.hpp"
+#include "../header/p6_snapshot.hpp"
+#include "../header/p6_math.hpp"
+#include "../header/p6_block_sparse_matrix.hpp"
+#include <algorithm>
+
+p6::uint p6::Stability::_free_pebbles(const Graph *graph, uint vertex) noexcept
+{
+	return (graph->pebble[2 * vertex] == (uint)-1 ? 1 : 0) + (graph->pebble[2 * vertex + 1] == (uint)-1 ? 1 : 0);
+}
+
+bool p6::Stability::_gather_pebble(Graph *graph, uint vertex, const uint blocked[2]) noexcept
+{
+	//Breadth-first search along directed edges for vertex with free pebble
+	graph->mark++;
+	graph->visit[vertex] = graph->mark;
+	graph->visit[blocked[0]] = graph->mark;
+	graph->visit[blocked[1]] = graph->mark;
+	graph->queue.clear();
+	graph->queue.push_back(vertex);
+	for (uint head = 0; head < graph->queue.size(); head++)
+	{
+		uint current = graph->queue[head];
+		for (uint i = 0; i < 2; i++)
+		{
+			uint target = graph->pebble[2 * current + i];
+			if (target == (uint)-1 || graph->visit[target] == graph->mark) continue;
+			graph->visit[target] = graph->mark;
+			graph->parent[target] = current;
+			if (_free_pebbles(graph, target) > 0)
+			{
+				//Reversing path, pebble moves one edge closer to vertex each step
+				while (target != vertex)
+				{
+					uint parent = graph->parent[target];
+					uint parent_pebble = (graph->pebble[2 * parent] == target) ? 0 : 1;
+					uint target_pebble = (graph->pebble[2 * target] == (uint)-1) ? 0 : 1;
+					graph->pebble[2 * target + target_pebble] = parent;
+					graph->pebble[2 * parent + parent_pebble] = (uint)-1;
+					target = parent;
+				}
+				return true;
+			}
+			graph->queue.push_back(target);
+		}
+	}
+	return false;
+}
+
+bool p6::Stability::_add_edge(Graph *graph, uint a, uint b) noexcept
+{
+	if (a == b) return false;
+
+	//Edge is independent if four pebbles can be gathered on it's vertices
+	const uint blocked_a[2] = { b, b };
+	while (_free_pebbles(graph, a) < 2 && _gather_pebble(graph, a, blocked_a)) {}
+	const uint blocked_b[2] = { a, a };
+	while (_free_pebbles(graph, b) < 2 && _gather_pebble(graph, b, blocked_b)) {}
+	if (_free_pebbles(graph, a) + _free_pebbles(graph, b) < 4) return false;
+
+	uint pebble = (graph->pebble[2 * a] == (uint)-1) ? 0 : 1;
+	graph->pebble[2 * a + pebble] = b;
+	return true;
+}
+
+void p6::Stability::_get_bars(const Snapshot *snapshot, std::vector<uint> *bars)
+{
+	bars->clear();
+	for (uint i = 0; i < snapshot->get_stick_count(); i++)
+	{
+		uint node[2];
+		snapshot->get_stick_node(i, node);
+		bars->push_back(node[0]);
+		bars->push_back(node[1]);
+	}
+
+	//Superelement is a rigid body, 2k-3 bars of a triangulation keep k boundary nodes together
+	for (uint i = 0; i < snapshot->get_superelement_count(); i++)
+	{
+		uint nnode = snapshot->get_superelement_node_count(i);
+		for (uint j = 1; j < nnode; j++)
+		{
+			for (uint k = (j >= 2) ? j - 2 : 0; k < j; k++)
+			{
+				bars->push_back(snapshot->get_superelement_node(i, k));
+				bars->push_back(snapshot->get_superelement_node(i, j));
+			}
+		}
+	}
+}
+
+void p6::Stability::_pebble_game(const Snapshot *snapshot)
+{
+	uint nnode = snapshot->get_node_count();
+	uint ground[2] = { nnode, nnode + 1 };
+	Graph graph;
+	graph.pebble.resize(2 * (nnode + 2), (uint)-1);
+	graph.visit.resize(nnode + 2, 0);
+	graph.parent.resize(nnode + 2, (uint)-1);
+
+	//Ground is a rigid body, fixed nodes are pinned to it with two edges, rail nodes with one
+	uint independent = 0;
+	if (_add_edge(&graph, ground[0], ground[1])) independent++;
+	for (uint i = 0; i < nnode; i++)
+	{
+		unsigned char freedom = snapshot->get_node_freedom(i);
+		if (freedom == 0)
+		{
+			if (_add_edge(&graph, i, ground[0])) independent++;
+			if (_add_edge(&graph, i, ground[1])) independent++;
+		}
+		else if (freedom == 1)
+		{
+			if (_add_edge(&graph, i, ground[0])) independent++;
+		}
+	}
+	std::vector<uint> bars;
+	_get_bars(snapshot, &bars);
+	for (uint i = 0; i < bars.size() / 2; i++)
+	{
+		if (_add_edge(&graph, bars[2 * i], bars[2 * i + 1])) independent++;
+	}
+
+	uint required = 2 * (nnode + 2) - 3;
+	if (independent == required) return;
+	_combinatorial = false;
+	_degrees = required - independent;
+
+	//Pinning three pebbles on ground, vertices that can not get a free pebble are rigidly connected to ground
+	const uint blocked[2][2] = { { ground[1], ground[1] }, { ground[0], ground[0] } };
+	while (_free_pebbles(&graph, ground[0]) < 2 && _gather_pebble(&graph, ground[0], blocked[0])) {}
+	while (_free_pebbles(&graph, ground[0]) + _free_pebbles(&graph, ground[1]) < 3 && _gather_pebble(&graph, ground[1], blocked[1])) {}
+	std::vector<bool> rigid(nnode + 2, false);
+	rigid[ground[0]] = rigid[ground[1]] = true;
+	for (uint i = 0; i < nnode; i++)
+	{
+		if (rigid[i]) continue;
+		if (_free_pebbles(&graph, i) > 0 || _gather_pebble(&graph, i, ground)) _node.push_back(i);
+		else for (uint j = 0; j < graph.queue.size(); j++) rigid[graph.queue[j]] = true;
+	}
+}
+
+void p6::Stability::_rank_check(const Snapshot *snapshot)
+{
+	//Free nodes are blocks of R^T * R, where R is rigidity matrix, derivative of sticks' lengths by coordinates
+	uint nnode = snapshot->get_node_count();
+	std::vector<uint> block(nnode, (uint)-1), block_node, size;
+	for (uint i = 0; i < nnode; i++)
+	{
+		unsigned char freedom = snapshot->get_node_freedom(i);
+		if (freedom == 0) continue;
+		block[i] = block_node.size();
+		block_node.push_back(i);
+		size.push_back(freedom);
+	}
+	if (block_node.empty()) return;
+	std::vector<uint> start(size.size() + 1, 0);
+	for (uint i = 0; i < size.size(); i++) start[i + 1] = start[i] + size[i];
+	std::vector<uint> bars, pattern;
+	_get_bars(snapshot, &bars);
+	for (uint i = 0; i < bars.size(); i++) pattern.push_back(block[bars[i]]);
+	BlockSparseMatrix stiffness;
+	stiffness.create(size, pattern);
+
+	//Each bar adds g * g^T, where g is row of R
+	for (uint i = 0; i < bars.size() / 2; i++)
+	{
+		const uint node[2] = { bars[2 * i], bars[2 * i + 1] };
+		Coord delta = snapshot->get_node_coord(node[1]) - snapshot->get_node_coord(node[0]);
+		if (delta.norm() == 0.0) continue;
+		Coord direction = delta / delta.norm();
+		uint index[4];
+		real row[4];
+		uint nrow = 0;
+		for (uint j = 0; j < 2; j++)
+		{
+			real sign = (j == 0) ? -1.0 : 1.0;
+			uint b = block[node[j]];
+			if (b == (uint)-1) continue;
+			if (size[b] == 1)
+			{
+				real angle = snapshot->get_node_rail_angle(node[j]);
+				index[nrow] = start[b];
+				row[nrow++] = sign * (direction.x * cos(angle) + direction.y * sin(angle));
+			}
+			else
+			{
+				index[nrow] = start[b];
+				row[nrow++] = sign * direction.x;
+				index[nrow] = start[b] + 1;
+				row[nrow++] = sign * direction.y;
+			}
+		}
+		for (uint j = 0; j < nrow; j++)
+		{
+			for (uint k = 0; k < nrow; k++) stiffness.at(index[j], index[k]) += row[j] * row[k];
+		}
+	}
+
+	//Envelope factorization costs as much as one solver's iteration, vanishing pivots are dependent variables
+	const real tolerance = 1e-10;
+	std::vector<uint> dependent;
+	if (stiffness.factorize_semidefinite(tolerance, &dependent)) return;
+	_geometric = false;
+	_degrees = dependent.size();
+	for (uint i = 0; i < dependent.size(); i++)
+	{
+		uint node = block_node[std::upper_bound(start.begin(), start.end(), dependent[i]) - start.begin() - 1];
+		if (std::find(_node.begin(), _node.end(), node) == _node.end()) _node.push_back(node);
+	}
+	std::sort(_node.begin(), _node.end());
+}
+
+p6::Stability::Stability(const Snapshot *snapshot)
+{
+	_pebble_game(snapshot);
+	if (_combinatorial) _rank_check(snapshot);
+}
+
+bool p6::Stability::stable() const noexcept
+{
+	return _combinatorial && _geometric;
+}
+
+bool p6::Stability::combinatorial() const noexcept
+{
+	return _combinatorial;
+}
+
+bool p6::Stability::geometric() const noexcept
+{
+	return _geometric;
+}
+
+p6::uint p6::Stability::get_degrees() const noexcept
+{
+	return _degrees;
+}
+
+p6::uint p6::Stability::get_node_count() const noexcept
+{
+	return _node.size();
+}
+
+p6::uint p6::Stability::get_node(uint index) const noexcept
+{
+	return _node[index];
+}
+
+p6::String p6::Stability::message() const
+{
+	if (stable()) return "Construction is stable";
+	String message = _combinatorial ?
+		"Construction is a mechanism in it's initial position (check collinear sticks), free nodes:" :
+		"Construction is a mechanism (not enough sticks or supports), free nodes:";
+	for (uint i = 0; i < _node.size() && i < 10; i++)
+	{
+		message += (i == 0) ? " " : ", ";
+		message += std::to_string(_node[i]);
+	}
+	if (_node.size() > 10) message += ", ...";
+	return message;
+}
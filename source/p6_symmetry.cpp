@@ -0,0 +1,271 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+#include "../header/p6_symmetry.hpp"
+#include "../header/p6_snapshot.hpp"
+#include "../header/p6_math.hpp"
+#include "../header/p6_block_sparse_matrix.hpp"
+#include <cassert>
+#include <algorithm>
+#include <map>
+
+bool p6::Symmetry::_find_mirrors(const Snapshot *snapshot, real tolerance) noexcept
+{
+	//Nodes sorted by height, mirror is searched among nodes of same height
+	uint nnode = snapshot->get_node_count();
+	std::vector<uint> order(nnode);
+	for (uint i = 0; i < nnode; i++) order[i] = i;
+	std::sort(order.begin(), order.end(), [snapshot](uint a, uint b) { return snapshot->get_node_coord(a).y < snapshot->get_node_coord(b).y; });
+
+	_mirror.resize(nnode);
+	for (uint i = 0; i < nnode; i++)
+	{
+		Coord coord = snapshot->get_node_coord(i);
+		Coord mirror = Coord(2.0 * _axis - coord.x, coord.y);
+		auto first = std::lower_bound(order.begin(), order.end(), coord.y - tolerance,
+			[snapshot](uint a, real y) { return snapshot->get_node_coord(a).y < y; });
+		_mirror[i] = (uint)-1;
+		for (auto j = first; j != order.end() && snapshot->get_node_coord(*j).y <= coord.y + tolerance; j++)
+		{
+			if (snapshot->get_node_coord(*j).distance(mirror) <= tolerance) { _mirror[i] = *j; break; }
+		}
+		if (_mirror[i] == (uint)-1) return false;
+	}
+	return true;
+}
+
+bool p6::Symmetry::_check_sticks(const Snapshot *snapshot) const noexcept
+{
+	std::map<std::pair<uint, uint>, uint> sticks;
+	for (uint i = 0; i < snapshot->get_stick_count(); i++)
+	{
+		uint node[2];
+		snapshot->get_stick_node(i, node);
+		sticks[std::make_pair(std::min(node[0], node[1]), std::max(node[0], node[1]))] = i;
+	}
+
+	for (uint i = 0; i < snapshot->get_stick_count(); i++)
+	{
+		uint node[2];
+		snapshot->get_stick_node(i, node);
+		uint mirror[2] = { _mirror[node[0]], _mirror[node[1]] };
+		auto found = sticks.find(std::make_pair(std::min(mirror[0], mirror[1]), std::max(mirror[0], mirror[1])));
+		if (found == sticks.end()
+			|| snapshot->get_stick_material(found->second) != snapshot->get_stick_material(i)
+			|| snapshot->get_stick_area(found->second) != snapshot->get_stick_area(i)) return false;
+	}
+	return true;
+}
+
+bool p6::Symmetry::_check_forces(const Snapshot *snapshot) const noexcept
+{
+	//Forces on the same node are summed
+	std::vector<Coord> force(snapshot->get_node_count(), Coord(0.0, 0.0));
+	real maxforce = 0.0;
+	for (uint i = 0; i < snapshot->get_force_count(); i++)
+	{
+		Coord direction = snapshot->get_force_direction(i);
+		force[snapshot->get_force_node(i)] = force[snapshot->get_force_node(i)] + direction;
+		if (direction.norm() > maxforce) maxforce = direction.norm();
+	}
+
+	for (uint i = 0; i < force.size(); i++)
+	{
+		Coord mirror = force[_mirror[i]];
+		if ((Coord(-mirror.x, mirror.y) - force[i]).norm() > 1e-9 * maxforce) return false;
+	}
+	return true;
+}
+
+bool p6::Symmetry::_create_reduction(const Snapshot *snapshot) noexcept
+{
+	uint nvariable = snapshot->get_variable_number();
+	_reduced.assign(nvariable, (uint)-1);
+	_sign.assign(nvariable, 0.0);
+	_nreduced = 0;
+	_block_size.clear();
+	_reduced_block.clear();
+	const real tolerance = 1e-9;
+
+	for (uint i = 0; i < snapshot->get_node_count(); i++)
+	{
+		uint mirror = _mirror[i];
+		unsigned char freedom = snapshot->get_node_freedom(i);
+		if (snapshot->get_node_freedom(mirror) != freedom) return false;
+		if (freedom == 0 || mirror < i) continue;
+
+		uint first = _nreduced;
+		uint variable[2], mirror_variable[2];
+		snapshot->get_node_variable(i, variable);
+		snapshot->get_node_variable(mirror, mirror_variable);
+		if (mirror == i)
+		{
+			//Node on axis can move only along axis
+			if (freedom == 1)
+			{
+				real angle = snapshot->get_node_rail_angle(i);
+				if (abs(cos(angle)) < tolerance)
+				{
+					_reduced[variable[0]] = _nreduced++;
+					_sign[variable[0]] = 1.0;
+				}
+				else if (abs(sin(angle)) > tolerance) return false;
+			}
+			else
+			{
+				_reduced[variable[1]] = _nreduced++;
+				_sign[variable[1]] = 1.0;
+			}
+		}
+		else if (freedom == 1)
+		{
+			//Mirror rail must be mirror line, variables are equal or opposite
+			real angle = snapshot->get_node_rail_angle(i);
+			real mirror_angle = snapshot->get_node_rail_angle(mirror);
+			Coord direction = Coord(-cos(angle), sin(angle));
+			Coord mirror_direction = Coord(cos(mirror_angle), sin(mirror_angle));
+			if (abs(direction.x * mirror_direction.y - direction.y * mirror_direction.x) > tolerance) return false;
+			_reduced[variable[0]] = _reduced[mirror_variable[0]] = _nreduced++;
+			_sign[variable[0]] = 1.0;
+			_sign[mirror_variable[0]] = (direction.x * mirror_direction.x + direction.y * mirror_direction.y > 0.0) ? 1.0 : -1.0;
+		}
+		else
+		{
+			//X displacements are opposite, Y displacements are equal
+			_reduced[variable[0]] = _reduced[mirror_variable[0]] = _nreduced++;
+			_sign[variable[0]] = 1.0;
+			_sign[mirror_variable[0]] = -1.0;
+			_reduced[variable[1]] = _reduced[mirror_variable[1]] = _nreduced++;
+			_sign[variable[1]] = 1.0;
+			_sign[mirror_variable[1]] = 1.0;
+		}
+
+		//Reduced variables of node and it's mirror form one block
+		if (_nreduced == first) continue;
+		_block_size.push_back(_nreduced - first);
+		_reduced_block.resize(_nreduced, _block_size.size() - 1);
+	}
+
+	_weight.assign(_nreduced, 0.0);
+	for (uint i = 0; i < nvariable; i++)
+	{
+		if (_reduced[i] != (uint)-1) _weight[_reduced[i]] += sqr(_sign[i]);
+	}
+	return true;
+}
+
+p6::Symmetry::Symmetry(const Snapshot *snapshot) noexcept
+{
+	//Superelements are not mirrored
+	if (snapshot->get_node_count() == 0 || snapshot->get_superelement_count() > 0) return;
+
+	//Axis goes through middle of bounding box
+	Coord min = snapshot->get_node_coord(0), max = min;
+	for (uint i = 1; i < snapshot->get_node_count(); i++)
+	{
+		Coord coord = snapshot->get_node_coord(i);
+		if (coord.x < min.x) min.x = coord.x;
+		if (coord.y < min.y) min.y = coord.y;
+		if (coord.x > max.x) max.x = coord.x;
+		if (coord.y > max.y) max.y = coord.y;
+	}
+	_axis = (min.x + max.x) / 2.0;
+	real extent = std::max(max.x - min.x, max.y - min.y);
+	real tolerance = 1e-9 * (extent > 0.0 ? extent : 1.0);
+
+	_symmetric = _find_mirrors(snapshot, tolerance)
+		&& _check_sticks(snapshot)
+		&& _check_forces(snapshot)
+		&& _create_reduction(snapshot);
+	if (!_symmetric) _mirror.clear();
+}
+
+bool p6::Symmetry::symmetric() const noexcept
+{
+	return _symmetric;
+}
+
+p6::real p6::Symmetry::get_axis() const noexcept
+{
+	return _axis;
+}
+
+p6::uint p6::Symmetry::get_mirror(uint node) const noexcept
+{
+	assert(_symmetric);
+	return _mirror[node];
+}
+
+p6::uint p6::Symmetry::get_variable_number() const noexcept
+{
+	return _nreduced;
+}
+
+void p6::Symmetry::reduce_vector(const Vector *z, Vector *reduced) const noexcept
+{
+	reduced->resize(_nreduced);
+	reduced->setZero();
+	for (uint i = 0; i < _reduced.size(); i++)
+	{
+		if (_reduced[i] != (uint)-1) (*reduced)(_reduced[i]) += _sign[i] * (*z)(i);
+	}
+}
+
+void p6::Symmetry::create_reduced_matrix(const BlockSparseMatrix *d, BlockSparseMatrix *reduced)
+{
+	//Every row of T has at most one entry, so blocks of d map to blocks of reduced matrix
+	std::vector<uint> row, column, pattern;
+	std::vector<real> value;
+	d->get_entries(&row, &column, &value);
+	for (uint i = 0; i < row.size(); i++)
+	{
+		if (_reduced[row[i]] == (uint)-1 || _reduced[column[i]] == (uint)-1) continue;
+		pattern.push_back(_reduced_block[_reduced[row[i]]]);
+		pattern.push_back(_reduced_block[_reduced[column[i]]]);
+	}
+	reduced->create(_block_size, pattern);
+
+	_target.assign(d->get_stored_value_count(), (uint)-1);
+	_factor.assign(d->get_stored_value_count(), 0.0);
+	for (uint i = 0; i < row.size(); i++)
+	{
+		if (_reduced[row[i]] == (uint)-1 || _reduced[column[i]] == (uint)-1) continue;
+		uint offset = d->find(row[i], column[i]);
+		_target[offset] = reduced->find(_reduced[row[i]], _reduced[column[i]]);
+		_factor[offset] = _sign[row[i]] * _sign[column[i]];
+	}
+}
+
+void p6::Symmetry::reduce_matrix(const BlockSparseMatrix *d, BlockSparseMatrix *reduced) const noexcept
+{
+	assert(_target.size() == d->get_stored_value_count());
+	reduced->set_zero();
+	for (uint i = 0; i < _target.size(); i++)
+	{
+		if (_target[i] != (uint)-1) reduced->value(_target[i]) += _factor[i] * d->value(i);
+	}
+}
+
+void p6::Symmetry::expand_vector(const Vector *reduced, Vector *m) const noexcept
+{
+	m->resize(_reduced.size());
+	for (uint i = 0; i < _reduced.size(); i++)
+	{
+		(*m)(i) = (_reduced[i] == (uint)-1) ? 0.0 : _sign[i] * (*reduced)(_reduced[i]);
+	}
+}
+
+void p6::Symmetry::project_vector(const Vector *z, Vector *p) const noexcept
+{
+	Vector reduced;
+	reduce_vector(z, &reduced);
+	for (uint i = 0; i < _nreduced; i++) reduced(i) /= _weight[i];
+	expand_vector(&reduced, p);
+}
@@ -11,9 +11,167 @@
 #include "../header/p6_construction.hpp"
 #include "../header/p6_linear_material.hpp"
 #include "../header/p6_nonlinear_material.hpp"
+#include "../header/p6_stability.hpp"
+#include "../header/p6_symmetry.hpp"
+#include "../header/p6_block_sparse_matrix.hpp"
+#include "../header/p6_linear_analysis.hpp"
+#include "../header/p6_sizing.hpp"
+#include "../header/p6_reduced_model.hpp"
+#include "../header/p6_modal_analysis.hpp"
+#include "../header/p6_convergence_monitor.hpp"
+#include "../header/p6_dispatcher.hpp"
+#include "../header/p6_domain_decomposition.hpp"
+#include "../header/p6_trace.hpp"
+#include "../header/p6_math.hpp"
 #include <gtest/gtest.h>
 #include <limits>
 #include <cmath>
+#include <thread>
+#include <cstdio>
+#include <sstream>
+#include <fstream>
+#include <atomic>
+#include <cstdlib>
+#ifdef _WIN32
+	#include <process.h>
+	#define getpid _getpid
+#else
+	#include <unistd.h>
+#endif
+
+//File with unique name in temporary directory, removed (with temporary copy written when checkpoint is replaced) when it goes out of scope
+class TemporaryFile
+{
+private:
+	std::string _path;
+
+public:
+	TemporaryFile(const char *name)
+	{
+		static std::atomic<unsigned int> counter(0);
+		const char *directory = std::getenv("TMPDIR");
+		if (directory == nullptr) directory = std::getenv("TEMP");
+		if (directory == nullptr) directory = std::getenv("TMP");
+		#ifndef _WIN32
+			if (directory == nullptr) directory = "/tmp";
+		#endif
+		_path = (directory == nullptr) ? "" : std::string(directory) + "/";
+		_path += "p6_test_" + std::to_string(getpid()) + "_" + std::to_string(counter++) + "_" + name;
+	}
+	~TemporaryFile()
+	{
+		std::remove(_path.c_str());
+		std::remove((_path + ".tmp").c_str());
+	}
+	const char *path() const { return _path.c_str(); }
+};
+
+//Creates Pratt bridge truss with given number of panels, left support is fixed, right is fixed or on horizontal rail
+static void create_bridge(p6::Construction *con, p6::uint panels, bool rail)
+{
+	con->create_linear_material("steel", 100000.0);
+	for (p6::uint i = 0; i <= panels; i++)
+	{
+		p6::uint node = con->create_node();
+		con->set_node_coord(node, p6::Coord((p6::real)i, 0.0));
+		if (i == panels && rail) { con->set_node_freedom(node, 1); con->set_node_rail_angle(node, 0.0); }
+		else if (i != 0 && i != panels) con->set_node_freedom(node, 2);
+	}
+	for (p6::uint i = 1; i < panels; i++)
+	{
+		p6::uint node = con->create_node();
+		con->set_node_coord(node, p6::Coord((p6::real)i, 1.0));
+		con->set_node_freedom(node, 2);
+	}
+	auto top = [panels](p6::uint i) { return panels + i; };
+	auto add_stick = [con](p6::uint a, p6::uint b)
+	{
+		p6::uint node[2] = { a, b };
+		p6::uint stick = con->create_stick(node);
+		con->set_stick_material(stick, 0);
+		con->set_stick_area(stick, 1.0);
+	};
+	for (p6::uint i = 0; i < panels; i++) add_stick(i, i + 1);
+	for (p6::uint i = 1; i + 1 < panels; i++) add_stick(top(i), top(i + 1));
+	for (p6::uint i = 1; i < panels; i++) add_stick(i, top(i));
+	add_stick(0, top(1));
+	add_stick(panels, top(panels - 1));
+	for (p6::uint i = 1; i + 1 < panels; i++)
+	{
+		if (2 * i < panels) add_stick(top(i), i + 1);
+		else add_stick(i, top(i + 1));
+	}
+	for (p6::uint i = 1; i < panels; i++)
+	{
+		p6::uint force = con->create_force(i);
+		con->set_force_direction(force, p6::Coord(0.0, -1.0));
+	}
+}
+
+//Bridge whose right support slides on inclined rail
+static void create_inclined_bridge(p6::Construction *con, p6::uint panels, p6::real angle)
+{
+	create_bridge(con, panels, true);
+	con->set_node_rail_angle(panels, angle);
+}
+
+//Wide wall standing on fixed ground, every panel has one diagonal, top row is pressed down
+static void create_wall(p6::Construction *con, p6::uint columns, p6::uint rows)
+{
+	con->create_linear_material("steel", 100000.0);
+	for (p6::uint row = 0; row <= rows; row++)
+	{
+		for (p6::uint column = 0; column <= columns; column++)
+		{
+			p6::uint node = con->create_node();
+			con->set_node_coord(node, p6::Coord((p6::real)column, (p6::real)row));
+			if (row > 0) con->set_node_freedom(node, 2);
+		}
+	}
+	auto index = [columns](p6::uint column, p6::uint row) { return row * (columns + 1) + column; };
+	auto add_stick = [con](p6::uint a, p6::uint b)
+	{
+		p6::uint node[2] = { a, b };
+		p6::uint stick = con->create_stick(node);
+		con->set_stick_material(stick, 0);
+		con->set_stick_area(stick, 1.0);
+	};
+	for (p6::uint row = 1; row <= rows; row++)
+	{
+		for (p6::uint column = 0; column <= columns; column++)
+		{
+			add_stick(index(column, row - 1), index(column, row));
+			if (column == columns) continue;
+			add_stick(index(column, row), index(column + 1, row));
+			if ((column + row) % 2 == 0) add_stick(index(column, row - 1), index(column + 1, row));
+			else add_stick(index(column + 1, row - 1), index(column, row));
+		}
+	}
+	for (p6::uint column = 0; column <= columns; column++)
+	{
+		p6::uint force = con->create_force(index(column, rows));
+		con->set_force_direction(force, p6::Coord(0.0, -1.0));
+	}
+}
+
+//Copies file without it's last bytes
+static void copy_truncated(const char *source, const char *target, p6::uint removed)
+{
+	std::ifstream input(source, std::ios::binary);
+	std::ostringstream content;
+	content << input.rdbuf();
+	std::ofstream output(target, std::ios::binary);
+	output.write(content.str().data(), content.str().size() - removed);
+}
+
+//Bridge saved for import as superelement, asymmetric one is loaded on left half only
+static void save_superelement_part(const char *filepath, p6::uint panels, bool asymmetric)
+{
+	p6::Construction part;
+	create_bridge(&part, panels, false);
+	if (asymmetric) { while (part.get_force_count() > panels / 2) part.delete_force(part.get_force_count() - 1); }
+	part.save(filepath);
+}
 
 //Linear material test
 TEST(LinearMaterial, NegativeModule)
@@ -94,6 +252,18 @@ TEST(NonlinearMaterial, GoodFormula2)
 	EXPECT_EQ(p6::NonlinearMaterial("name", "-s * s + s / 2 - 1").derivative(3.0), -5.5);
 }
 
+TEST(NonlinearMaterial, DeepFormula)
+{
+	//Right operands are calculated first, so stack of left-nested brackets does not fit into fixed buffer
+	p6::String formula = "s";
+	for (p6::uint i = 0; i < 100; i++) formula = "(" + formula + ") + 1";
+	p6::NonlinearMaterial material("name", formula);
+	p6::real stress, derivative;
+	material.calculate(3.0, &stress, &derivative);
+	EXPECT_EQ(stress, 103.0);
+	EXPECT_EQ(derivative, 1.0);
+}
+
 //Construction
 TEST(Construction, LinearCalculation)
 {
@@ -163,6 +333,1279 @@ TEST(Construction, NonlinearCalculation)
 	EXPECT_NEAR(con.get_node_coord(2).y, 0.985997, 0.001);
 }
 
+TEST(Construction, BridgeCalculation)
+{
+	p6::Construction con;
+	create_bridge(&con, 6, true);
+	con.simulate(true);
+	//Mid-span bottom node sags, supports do not move vertically
+	EXPECT_LT(con.get_node_coord(3).y, 0.0);
+	EXPECT_NEAR(con.get_node_coord(6).y, 0.0, 1e-12);
+	//Bottom chord is in tension, top chord is in compression
+	EXPECT_GT(con.get_stick_force(2), 0.0);
+	EXPECT_LT(con.get_stick_force(7), 0.0);
+}
+
+TEST(Construction, MatrixFreeBridge)
+{
+	p6::Construction direct, matrix_free;
+	create_bridge(&direct, 8, true);
+	create_bridge(&matrix_free, 8, true);
+	p6::Snapshot::Options options;
+	options.method = p6::Snapshot::Method::matrix_free;
+	matrix_free.set_options(&options);
+	EXPECT_GT(matrix_free.snapshot().solve(&options).get_krylov_iterations(), 0);
+	direct.simulate(true);
+	matrix_free.simulate(true);
+	for (p6::uint i = 0; i < direct.get_node_count(); i++)
+	{
+		EXPECT_NEAR(direct.get_node_coord(i).x, matrix_free.get_node_coord(i).x, 1e-8);
+		EXPECT_NEAR(direct.get_node_coord(i).y, matrix_free.get_node_coord(i).y, 1e-8);
+	}
+}
+
+TEST(Construction, TruncatedKrylovBridge)
+{
+	//Long sticks make any modification small, GMRES stopped far from solution must not be taken for convergence
+	p6::Construction con;
+	create_bridge(&con, 8, true);
+	for (p6::uint i = 0; i < con.get_node_count(); i++) con.set_node_coord(i, con.get_node_coord(i) * 1e6);
+	for (p6::uint i = 0; i < con.get_force_count(); i++) con.set_force_direction(i, p6::Coord(0.0, -1e-5));
+	p6::Snapshot snapshot = con.snapshot();
+	EXPECT_LT(snapshot.solve().get_node_coord(4).y, 0.0);
+	p6::Snapshot::Options options;
+	options.method = p6::Snapshot::Method::matrix_free;
+	options.krylov_iterations = 1;
+	try { snapshot.solve(&options); FAIL(); }
+	catch (p6::ConvergenceError &e) { EXPECT_EQ(e.diagnosis(), p6::ConvergenceMonitor::Diagnosis::stagnation); }
+}
+
+TEST(Construction, InclinedRail)
+{
+	p6::Construction con;
+	create_inclined_bridge(&con, 8, 0.3);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Snapshot::Options options;
+	options.method = p6::Snapshot::Method::direct;
+	p6::Solution direct = snapshot.solve(&options);
+
+	//Rail node moves along rail, every method finds the same equilibrium
+	p6::Coord displacement = direct.get_node_coord(8) - p6::Coord(8.0, 0.0);
+	EXPECT_GT(displacement.norm(), 1e-6);
+	EXPECT_NEAR(displacement.x * sin(0.3) - displacement.y * cos(0.3), 0.0, 1e-12);
+	for (p6::Snapshot::Method method : { p6::Snapshot::Method::matrix_free, p6::Snapshot::Method::decomposition, p6::Snapshot::Method::automatic })
+	{
+		options.method = method;
+		options.threads = 2;
+		p6::Solution solution = snapshot.solve(&options);
+		for (p6::uint i = 0; i < direct.get_node_count(); i++)
+		{
+			EXPECT_NEAR(solution.get_node_coord(i).x, direct.get_node_coord(i).x, 1e-6);
+			EXPECT_NEAR(solution.get_node_coord(i).y, direct.get_node_coord(i).y, 1e-6);
+		}
+	}
+}
+
+TEST(Construction, MixedPrecisionBridge)
+{
+	p6::Construction con;
+	create_bridge(&con, 8, true);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Snapshot::Options options;
+	p6::Solution direct = snapshot.solve(&options);
+	options.mixed_precision = true;
+	p6::Solution mixed = snapshot.solve(&options);
+	for (p6::uint i = 0; i < direct.get_node_count(); i++)
+	{
+		EXPECT_NEAR(direct.get_node_coord(i).x, mixed.get_node_coord(i).x, 1e-10);
+		EXPECT_NEAR(direct.get_node_coord(i).y, mixed.get_node_coord(i).y, 1e-10);
+	}
+}
+
+TEST(Construction, IncrementalAssemblyBridge)
+{
+	p6::Construction con;
+	create_bridge(&con, 8, true);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Snapshot::Options options;
+	p6::Solution full = snapshot.solve(&options);
+	//Some sticks keep derivatives of undeformed state
+	options.reassembly_threshold = 1e-4;
+	p6::Solution incremental = snapshot.solve(&options);
+	for (p6::uint i = 0; i < full.get_node_count(); i++)
+	{
+		EXPECT_NEAR(full.get_node_coord(i).x, incremental.get_node_coord(i).x, 1e-10);
+		EXPECT_NEAR(full.get_node_coord(i).y, incremental.get_node_coord(i).y, 1e-10);
+	}
+}
+
+TEST(Construction, PoorlyScaledBridge)
+{
+	//Millimetres and very stiff sticks, rounding of forces is above absolute tolerance
+	p6::Construction con;
+	create_bridge(&con, 8, true);
+	for (p6::uint i = 0; i < con.get_node_count(); i++) con.set_node_coord(i, con.get_node_coord(i) * 1000.0);
+	for (p6::uint i = 0; i < con.get_stick_count(); i++) con.set_stick_area(i, 2e8);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Snapshot::Options options;
+	options.scaling = false;
+	EXPECT_ANY_THROW(snapshot.solve(&options));
+	options.scaling = true;
+	p6::Solution solution = snapshot.solve(&options);
+	EXPECT_LE(solution.get_iterations(), 2);
+	EXPECT_LT(solution.get_node_coord(4).y, 0.0);
+}
+
+TEST(Construction, SimulationBudget)
+{
+	p6::Construction con;
+	create_bridge(&con, 8, true);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Snapshot::Options options;
+	options.method = p6::Snapshot::Method::direct;
+	options.max_iterations = 1;
+	try { snapshot.solve(&options); FAIL(); }
+	catch (p6::ConvergenceError &e) { EXPECT_EQ(e.diagnosis(), p6::ConvergenceMonitor::Diagnosis::iteration_budget); }
+
+	//Unscaled residual of poorly scaled bridge stays at rounding level above tolerance
+	for (p6::uint i = 0; i < con.get_node_count(); i++) con.set_node_coord(i, con.get_node_coord(i) * 1000.0);
+	for (p6::uint i = 0; i < con.get_stick_count(); i++) con.set_stick_area(i, 2e8);
+	snapshot = con.snapshot();
+	options = p6::Snapshot::Options();
+	options.scaling = false;
+	try { snapshot.solve(&options); FAIL(); }
+	catch (p6::ConvergenceError &e) { EXPECT_EQ(e.diagnosis(), p6::ConvergenceMonitor::Diagnosis::stagnation); }
+}
+
+TEST(Construction, SimulationStatistics)
+{
+	p6::Construction con;
+	create_bridge(&con, 8, true);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Snapshot::Options options;
+	p6::Solution solution = snapshot.solve(&options);
+	const p6::Statistics *statistics = solution.get_statistics();
+	if (p6::Statistics::enabled)
+	{
+		EXPECT_EQ(statistics->create_map.calls, 1);
+		EXPECT_EQ(statistics->create_vectors.calls, 1);
+		EXPECT_GE(statistics->assembly.calls, solution.get_iterations());
+		EXPECT_EQ(statistics->factorization.calls, solution.get_iterations());
+		EXPECT_EQ(statistics->adequacy.calls, solution.get_iterations());
+		EXPECT_EQ(statistics->newton_steps + statistics->flow_steps, solution.get_iterations());
+		EXPECT_EQ(statistics->flow.calls, statistics->flow_steps);
+		EXPECT_EQ(statistics->apply.calls, 1);
+		EXPECT_GT(statistics->factorization.time, 0.0);
+	}
+	else
+	{
+		EXPECT_EQ(statistics->assembly.calls, 0);
+		EXPECT_EQ(statistics->newton_steps, 0);
+		EXPECT_EQ(statistics->assembly.time, 0.0);
+	}
+}
+
+//Observer that keeps all received iterations
+class RecordingObserver : public p6::Snapshot::Observer
+{
+public:
+	std::vector<p6::Snapshot::Iteration> iteration;
+	void observe(const p6::Snapshot::Iteration *iteration) override { this->iteration.push_back(*iteration); }
+};
+
+TEST(Construction, ConvergenceObserver)
+{
+	p6::Construction con;
+	create_bridge(&con, 8, true);
+	p6::Snapshot snapshot = con.snapshot();
+	RecordingObserver observer;
+	p6::Snapshot::Options options;
+	options.method = p6::Snapshot::Method::direct;
+	options.observer = &observer;
+	options.load_steps = 2;
+	p6::Solution solution = snapshot.solve(&options);
+
+	//Every iteration is reported once, residual of each load step decreases
+	ASSERT_EQ(observer.iteration.size(), solution.get_iterations());
+	for (p6::uint i = 0; i < observer.iteration.size(); i++)
+	{
+		const p6::Snapshot::Iteration *iteration = &observer.iteration[i];
+		EXPECT_EQ(iteration->iteration, i + 1);
+		EXPECT_GT(iteration->step_norm, 0.0);
+		if (i > 0)
+		{
+			EXPECT_GE(iteration->step, observer.iteration[i - 1].step);
+			EXPECT_GE(iteration->time, observer.iteration[i - 1].time);
+		}
+	}
+	EXPECT_EQ(observer.iteration.front().step, 1);
+	EXPECT_EQ(observer.iteration.back().step, 2);
+	EXPECT_TRUE(observer.iteration.back().newton);
+	EXPECT_LT(observer.iteration.back().residual, observer.iteration.front().residual);
+}
+
+TEST(Construction, AutomaticSolver)
+{
+	p6::Construction con;
+	create_bridge(&con, 8, true);
+	EXPECT_EQ(con.get_options().method, p6::Snapshot::Method::automatic);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Snapshot::Options options;
+	p6::Dispatcher dispatcher(&snapshot, &options);
+	const p6::Dispatcher::Record *record = dispatcher.get_record();
+	EXPECT_EQ(record->variables, snapshot.get_variable_number());
+	EXPECT_TRUE(record->linear);
+	EXPECT_FALSE(record->symmetric);
+	EXPECT_EQ(record->backend, p6::Dispatcher::Backend::direct);
+	EXPECT_TRUE(record->linear_start);
+	EXPECT_GT(record->estimated_time, 0.0);
+
+	//Same equilibrium as direct solver
+	p6::Solution automatic = dispatcher.solve(&snapshot);
+	options.method = p6::Snapshot::Method::direct;
+	p6::Solution direct = snapshot.solve(&options);
+	EXPECT_GT(record->iterations, 0);
+	for (p6::uint i = 0; i < direct.get_node_count(); i++)
+	{
+		EXPECT_NEAR(automatic.get_node_coord(i).x, direct.get_node_coord(i).x, 1e-10);
+		EXPECT_NEAR(automatic.get_node_coord(i).y, direct.get_node_coord(i).y, 1e-10);
+	}
+
+	//Choice is logged by construction
+	std::ostringstream log;
+	options.method = p6::Snapshot::Method::automatic;
+	con.set_options(&options);
+	con.set_log(&log);
+	con.simulate(true);
+	EXPECT_NE(log.str().find("Solver: direct from small-displacement solution"), std::string::npos);
+	EXPECT_NE(log.str().find("actual"), std::string::npos);
+
+	//Heavy load is out of reach of Newton's iterations from initial position, but not from small-displacement solution
+	con.simulate(false);
+	for (p6::uint i = 0; i < con.get_force_count(); i++) con.set_force_direction(i, con.get_force_direction(i) * 30.0);
+	snapshot = con.snapshot();
+	options.method = p6::Snapshot::Method::direct;
+	EXPECT_THROW(snapshot.solve(&options), p6::ConvergenceError);
+	options.method = p6::Snapshot::Method::automatic;
+	EXPECT_LT(snapshot.solve(&options).get_node_coord(4).y, 0.0);
+}
+
+TEST(Construction, LargeWall)
+{
+	//Envelope of thousands of variables is limited by short side of wall, few iterations are needed
+	p6::Construction con;
+	create_wall(&con, 100, 20);
+	p6::Snapshot snapshot = con.snapshot();
+	const p6::uint variables = snapshot.get_variable_number();
+	ASSERT_GT(variables, 4000);
+	p6::BlockSparseMatrix d;
+	std::vector<p6::uint> scatter;
+	snapshot.create_tangent(&d, &scatter);
+	const p6::uint width = 4 * (20 + 2);	//Variables of about two columns of nodes
+	EXPECT_LT(d.get_envelope_size(), variables * width);
+	EXPECT_LT(d.get_factorization_cost(), (p6::real)variables * width * width);
+	p6::Solution solution = snapshot.solve();
+	EXPECT_LE(solution.get_iterations(), 3);
+
+	//Unit loads on columns of unit area shorten them less than columns alone, diagonals carry part of load
+	p6::real shortening = 20.0 - solution.get_node_coord(20 * 101 + 50).y;
+	EXPECT_GT(shortening, 0.5 * 20.0 / 100000.0);
+	EXPECT_LT(shortening, 20.0 / 100000.0);
+	p6::Vector s, z;
+	snapshot.get_state(&solution, &s);
+	snapshot.get_residual(&s, &z);
+	EXPECT_LT(z.cwiseAbs().maxCoeff(), 1e-4);
+}
+
+TEST(Construction, LoadStepsAndCheckpoint)
+{
+	TemporaryFile checkpoint_file("checkpoint.p6c");
+
+	//Heavy load is reached in steps
+	p6::Construction con;
+	create_bridge(&con, 8, true);
+	for (p6::uint i = 0; i < con.get_force_count(); i++) con.set_force_direction(i, con.get_force_direction(i) * 30.0);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Snapshot::Options options;
+	options.load_steps = 30;
+	p6::Solution stepped = snapshot.solve(&options);
+	options.load_steps = 1;
+	options.method = p6::Snapshot::Method::automatic;
+	p6::Solution automatic = snapshot.solve(&options);
+	for (p6::uint i = 0; i < stepped.get_node_count(); i++)
+	{
+		//Both are within force tolerance of equilibrium, but reach it differently
+		EXPECT_NEAR(stepped.get_node_coord(i).x, automatic.get_node_coord(i).x, 1e-6);
+		EXPECT_NEAR(stepped.get_node_coord(i).y, automatic.get_node_coord(i).y, 1e-6);
+	}
+
+	//Run aborted by budget is resumed from state of last finished load step
+	options = p6::Snapshot::Options();
+	options.load_steps = 30;
+	options.checkpoint_path = checkpoint_file.path();
+	options.max_iterations = stepped.get_iterations() / 2;
+	EXPECT_THROW(snapshot.solve(&options), p6::ConvergenceError);
+	options.max_iterations = 10000;
+	p6::Solution resumed = snapshot.resume(checkpoint_file.path(), &options);
+	EXPECT_GE(resumed.get_iterations(), stepped.get_iterations());
+	for (p6::uint i = 0; i < stepped.get_node_count(); i++)
+	{
+		EXPECT_NEAR(resumed.get_node_coord(i).x, stepped.get_node_coord(i).x, 1e-10);
+		EXPECT_NEAR(resumed.get_node_coord(i).y, stepped.get_node_coord(i).y, 1e-10);
+	}
+
+	//Checkpoint belongs to construction with the same nodes
+	p6::Construction other;
+	create_bridge(&other, 6, true);
+	EXPECT_ANY_THROW(other.snapshot().resume(checkpoint_file.path()));
+}
+
+TEST(Construction, TruncatedCheckpoint)
+{
+	TemporaryFile checkpoint_file("checkpoint.p6c");
+	TemporaryFile truncated_file("truncated.p6c");
+	p6::Construction con;
+	create_bridge(&con, 8, true);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Snapshot::Options options;
+	options.load_steps = 2;
+	options.checkpoint_path = checkpoint_file.path();
+	p6::Solution solution = snapshot.solve(&options);
+	options.checkpoint_path.clear();
+
+	//Complete checkpoint of finished simulation gives the same solution
+	p6::Solution resumed = snapshot.resume(checkpoint_file.path(), &options);
+	EXPECT_NEAR(resumed.get_node_coord(4).y, solution.get_node_coord(4).y, 1e-12);
+
+	//Missing end of state or of header is detected
+	for (p6::uint removed : { (p6::uint)1, (p6::uint)sizeof(p6::real), (p6::uint)(snapshot.get_variable_number() * sizeof(p6::real) + 4) })
+	{
+		copy_truncated(checkpoint_file.path(), truncated_file.path(), removed);
+		EXPECT_ANY_THROW(snapshot.resume(truncated_file.path(), &options));
+	}
+}
+
+//Snapshot
+TEST(Construction, AdjointSensitivity)
+{
+	p6::Construction con;
+	create_bridge(&con, 6, true);
+	con.create_nonlinear_material("rubber", "10000*s+500000*s*s");
+	con.set_stick_material(4, 1);
+	con.simulate(true);
+	p6::Snapshot::Response responses[3];
+	responses[1].type = p6::Snapshot::Response::Type::node_displacement;
+	responses[1].index = 3;
+	responses[1].direction = p6::Coord(0.0, 1.0);
+	responses[2].type = p6::Snapshot::Response::Type::stick_force;
+	responses[2].index = 2;
+	auto evaluate = [](const p6::Construction *c, const p6::Snapshot::Response *response)
+	{
+		if (response->type == p6::Snapshot::Response::Type::stick_force) return c->get_stick_force(response->index);
+		if (response->type == p6::Snapshot::Response::Type::node_displacement) return c->get_node_coord(response->index).y;
+		//Unit loads pull nodes 1 to 5 down from zero height
+		return -(c->get_node_coord(1).y + c->get_node_coord(2).y + c->get_node_coord(3).y + c->get_node_coord(4).y + c->get_node_coord(5).y);
+	};
+
+	//Matches central differences of simulations
+	for (p6::uint r = 0; r < 3; r++)
+	{
+		std::vector<p6::real> area, modulus;
+		con.get_sensitivity(&responses[r], &area, &modulus);
+		for (p6::uint stick : { 2, 4, 7 })
+		{
+			const p6::real h = 1e-2;
+			p6::Construction plus, minus;
+			create_bridge(&plus, 6, true);
+			create_bridge(&minus, 6, true);
+			plus.create_nonlinear_material("rubber", "10000*s+500000*s*s");
+			minus.create_nonlinear_material("rubber", "10000*s+500000*s*s");
+			plus.set_stick_material(4, 1);
+			minus.set_stick_material(4, 1);
+			plus.set_stick_area(stick, 1.0 + h);
+			minus.set_stick_area(stick, 1.0 - h);
+			plus.simulate(true);
+			minus.simulate(true);
+			p6::real difference = (evaluate(&plus, &responses[r]) - evaluate(&minus, &responses[r])) / (2 * h);
+			EXPECT_NEAR(area[stick], difference, 1e-3 * abs(difference) + 1e-9);
+		}
+		//Linear stick's force is proportional to area * modulus
+		EXPECT_NEAR(modulus[7] * 100000.0, area[7] * 1.0, 1e-9 * abs(area[7]) + 1e-15);
+	}
+
+	//Material without initial slope has no derivative by modulus, derivative by area stays finite
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Solution solution = snapshot.solve();
+	con.simulate(false);
+	con.create_nonlinear_material("cubic", "100000000*s*s*s");
+	con.set_stick_material(4, 2);
+	snapshot = con.snapshot();
+	std::vector<p6::real> area, modulus;
+	snapshot.get_sensitivity(&solution, &responses[1], &area, &modulus);
+	EXPECT_EQ(modulus[4], 0.0);
+	for (p6::uint i = 0; i < con.get_stick_count(); i++) { EXPECT_TRUE(std::isfinite(area[i])); EXPECT_TRUE(std::isfinite(modulus[i])); }
+}
+
+TEST(Sizing, FullyStressedBridge)
+{
+	p6::Construction con;
+	create_bridge(&con, 6, true);
+	std::vector<p6::real> limit = { 1.0 };
+	p6::Sizing sizing(&con, &limit, 1e-3);
+	ASSERT_TRUE(sizing.converged());
+	EXPECT_GT(sizing.get_iteration_count(), 1);
+	EXPECT_NEAR(sizing.get_iteration(sizing.get_iteration_count() - 1).max_ratio, 1.0, 1e-3);
+	EXPECT_GE(sizing.get_solver_time(), 0.0);
+
+	//Every stick is fully stressed or minimal
+	con.simulate(true);
+	for (p6::uint i = 0; i < con.get_stick_count(); i++)
+	{
+		p6::real stress = abs(con.get_stick_force(i)) / con.get_stick_area(i);
+		if (con.get_stick_area(i) > 1.001e-3) EXPECT_NEAR(stress, 1.0, 2e-3);
+		else EXPECT_LE(stress, 1.002);
+	}
+}
+
+//Reduced model
+TEST(ReducedModel, LoadSweep)
+{
+	p6::Construction con;
+	create_bridge(&con, 8, true);
+	auto set_load = [&con](p6::real vertical, p6::real horizontal)
+	{
+		for (p6::uint i = 0; i < con.get_force_count(); i++) con.set_force_direction(i, p6::Coord(horizontal, -vertical * (p6::real)(i + 1)));
+	};
+
+	//Samples are taken at several load levels and patterns
+	p6::ReducedModel model(1e-6);
+	for (p6::uint i = 1; i <= 4; i++)
+	{
+		set_load((p6::real)i * 0.1, 0.0);
+		p6::Snapshot snapshot = con.snapshot();
+		p6::Solution solution = snapshot.solve();
+		model.add_sample(&snapshot, &solution);
+	}
+	EXPECT_EQ(model.get_sample_count(), 4);
+	p6::uint nmode = model.create_basis();
+	EXPECT_GT(nmode, 0);
+	EXPECT_LE(nmode, 4);
+
+	//Load between samples is solved in reduced space
+	set_load(0.25, 0.0);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Solution reduced = model.solve(&snapshot);
+	p6::Solution full = snapshot.solve();
+	EXPECT_EQ(model.get_reduced_count(), 1);
+	EXPECT_EQ(model.get_full_count(), 0);
+	for (p6::uint i = 0; i < full.get_node_count(); i++)
+	{
+		EXPECT_NEAR(reduced.get_node_coord(i).x, full.get_node_coord(i).x, 1e-8);
+		EXPECT_NEAR(reduced.get_node_coord(i).y, full.get_node_coord(i).y, 1e-8);
+	}
+
+	//Horizontal load is outside of basis and is solved fully
+	set_load(0.25, 0.05);
+	snapshot = con.snapshot();
+	reduced = model.solve(&snapshot);
+	full = snapshot.solve();
+	EXPECT_EQ(model.get_full_count(), 1);
+	for (p6::uint i = 0; i < full.get_node_count(); i++)
+	{
+		EXPECT_NEAR(reduced.get_node_coord(i).x, full.get_node_coord(i).x, 1e-8);
+		EXPECT_NEAR(reduced.get_node_coord(i).y, full.get_node_coord(i).y, 1e-8);
+	}
+}
+
+//Modal analysis
+TEST(ModalAnalysis, MatchesDense)
+{
+	p6::Construction con;
+	create_bridge(&con, 6, true);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Solution solution = snapshot.solve();
+	std::vector<p6::real> density(con.get_stick_count(), 7.8);
+	p6::ModalAnalysis modal(&snapshot, &solution, &density, 3);
+	ASSERT_TRUE(modal.converged());
+	ASSERT_EQ(modal.get_mode_count(), 3);
+
+	//Dense generalized eigenproblem with the same stiffness and masses
+	p6::Vector s;
+	p6::Matrix d;
+	snapshot.get_state(&solution, &s);
+	snapshot.get_tangent(&s, &d);
+	p6::Matrix m = p6::Matrix::Zero(d.rows(), d.cols());
+	for (p6::uint i = 0; i < con.get_node_count(); i++)
+	{
+		p6::uint variable[2];
+		snapshot.get_node_variable(i, variable);
+		for (p6::uint j = 0; j < 2; j++) if (variable[j] != (p6::uint)-1) m(variable[j], variable[j]) = modal.get_node_mass(i);
+	}
+	Eigen::GeneralizedSelfAdjointEigenSolver<Eigen::Matrix<p6::real, Eigen::Dynamic, Eigen::Dynamic>> dense(-d, m);
+	for (p6::uint i = 0; i < 3; i++) EXPECT_NEAR(modal.get_eigenvalue(i), dense.eigenvalues()(i), 1e-8 * dense.eigenvalues()(i));
+	EXPECT_NEAR(modal.get_frequency(0), sqrt(dense.eigenvalues()(0)), 1e-8 * sqrt(dense.eigenvalues()(0)));
+
+	//Mode shapes are mass-normalized, supports do not move
+	p6::real norm = 0.0;
+	for (p6::uint i = 0; i < con.get_node_count(); i++)
+	{
+		p6::Coord shape = modal.get_mode_shape(0, i);
+		norm += modal.get_node_mass(i) * (shape.x * shape.x + shape.y * shape.y);
+	}
+	EXPECT_NEAR(norm, 1.0, 1e-10);
+	EXPECT_EQ(modal.get_mode_shape(0, 0).norm(), 0.0);
+	EXPECT_EQ(modal.get_mode_shape(0, 6).y, 0.0);
+
+	//Shift between second and third eigenvalues finds closest mode
+	p6::real shift = 0.4 * dense.eigenvalues()(1) + 0.6 * dense.eigenvalues()(2);
+	p6::ModalAnalysis shifted(&snapshot, &solution, &density, 1, shift);
+	ASSERT_EQ(shifted.get_mode_count(), 1);
+	EXPECT_NEAR(shifted.get_eigenvalue(0), dense.eigenvalues()(2), 1e-8 * dense.eigenvalues()(2));
+}
+
+TEST(Snapshot, ConcurrentSolve)
+{
+	p6::Construction con;
+	create_bridge(&con, 8, true);
+	const p6::Snapshot snapshot = con.snapshot();
+	p6::Solution solution[4];
+	std::thread thread[4];
+	for (p6::uint i = 0; i < 4; i++) thread[i] = std::thread([&snapshot, &solution, i]() { solution[i] = snapshot.solve(); });
+	for (p6::uint i = 0; i < 4; i++) thread[i].join();
+
+	con.simulate(true);
+	for (p6::uint i = 0; i < 4; i++)
+	{
+		ASSERT_EQ(solution[i].get_node_count(), con.get_node_count());
+		for (p6::uint j = 0; j < con.get_node_count(); j++)
+		{
+			EXPECT_EQ(solution[i].get_node_coord(j).x, con.get_node_coord(j).x);
+			EXPECT_EQ(solution[i].get_node_coord(j).y, con.get_node_coord(j).y);
+		}
+	}
+}
+
+TEST(Snapshot, NoMaterial)
+{
+	p6::Construction con;
+	create_bridge(&con, 4, true);
+	p6::uint node[2] = { 0, 2 };
+	con.create_stick(node);
+	EXPECT_ANY_THROW(con.snapshot());
+}
+
+//Convergence monitor
+TEST(ConvergenceMonitor, Classification)
+{
+	//Quadratic convergence
+	p6::ConvergenceMonitor converging(100, 0.0, 50);
+	for (p6::real residual = 1.0; residual > 1e-12; residual *= residual / 10.0) EXPECT_EQ(converging.check(residual), p6::ConvergenceMonitor::Diagnosis::none);
+
+	//Steady growth
+	p6::ConvergenceMonitor diverging(1000, 0.0, 50);
+	p6::ConvergenceMonitor::Diagnosis diagnosis = p6::ConvergenceMonitor::Diagnosis::none;
+	for (p6::uint i = 0; i < 100 && diagnosis == p6::ConvergenceMonitor::Diagnosis::none; i++) diagnosis = diverging.check(pow(10.0, (p6::real)i));
+	EXPECT_EQ(diagnosis, p6::ConvergenceMonitor::Diagnosis::divergence);
+	EXPECT_LT(diverging.get_iterations(), 10);
+	EXPECT_EQ(diverging.check(std::numeric_limits<p6::real>::quiet_NaN()), p6::ConvergenceMonitor::Diagnosis::divergence);
+
+	//Jumping between two values
+	p6::ConvergenceMonitor oscillating(1000, 0.0, 50);
+	diagnosis = p6::ConvergenceMonitor::Diagnosis::none;
+	for (p6::uint i = 0; i < 100 && diagnosis == p6::ConvergenceMonitor::Diagnosis::none; i++) diagnosis = oscillating.check(i % 2 == 0 ? 1.0 : 2.0);
+	EXPECT_EQ(diagnosis, p6::ConvergenceMonitor::Diagnosis::oscillation);
+	EXPECT_EQ(oscillating.get_iterations(), 21);
+
+	//Slow but steady decrease is not stagnation, flat residual is
+	p6::ConvergenceMonitor stagnating(1000, 0.0, 50);
+	for (p6::uint i = 0; i < 200; i++)
+	{
+		EXPECT_EQ(stagnating.check(pow(0.99, (p6::real)i)), p6::ConvergenceMonitor::Diagnosis::none);
+		stagnating.add_step(i % 4 == 0);
+	}
+	diagnosis = p6::ConvergenceMonitor::Diagnosis::none;
+	for (p6::uint i = 0; i < 100 && diagnosis == p6::ConvergenceMonitor::Diagnosis::none; i++) diagnosis = stagnating.check(0.1);
+	EXPECT_EQ(diagnosis, p6::ConvergenceMonitor::Diagnosis::stagnation);
+	EXPECT_NEAR(stagnating.get_acceptance_ratio(), 0.25, 1e-12);
+}
+
+//Trace
+TEST(Trace, ConcurrentRecording)
+{
+	TemporaryFile trace_file("trace.json");
+
+	//Events are recorded only when trace is enabled
+	p6::Trace::clear();
+	EXPECT_EQ(p6::Trace::get_event_count(), 0);
+	{ p6::TraceScope trace("disabled"); }
+	EXPECT_EQ(p6::Trace::get_event_count(), 0);
+
+	//Threads fill several blocks each while events are counted
+	p6::Trace::enable(true);
+	const p6::uint nthread = 4, nevent = 5000;
+	std::vector<std::thread> pool;
+	for (p6::uint i = 0; i < nthread; i++)
+	{
+		pool.push_back(std::thread([]()
+		{
+			for (p6::uint j = 0; j < nevent; j++) p6::TraceScope trace("event");
+		}));
+	}
+	EXPECT_LE(p6::Trace::get_event_count(), nthread * nevent);
+	for (p6::uint i = 0; i < pool.size(); i++) pool[i].join();
+	EXPECT_EQ(p6::Trace::get_event_count(), nthread * nevent);
+	p6::Construction con;
+	create_bridge(&con, 4, true);
+	con.simulate(true);
+	p6::Trace::enable(false);
+
+	//Trace is written as Chrome trace JSON
+	p6::Trace::write(trace_file.path());
+	std::ifstream file(trace_file.path());
+	std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	auto count = [&json](const std::string &pattern)
+	{
+		p6::uint count = 0;
+		for (size_t position = json.find(pattern); position != std::string::npos; position = json.find(pattern, position + 1)) count++;
+		return count;
+	};
+	EXPECT_EQ(json.find("{\"traceEvents\":["), 0);
+	EXPECT_EQ(count("{\"name\":\"event\",\"ph\":\"X\""), nthread * nevent);
+	EXPECT_GT(count("{\"name\":\"Construction::simulate\",\"ph\":\"X\""), 0);
+	EXPECT_EQ(count("\"ph\":\"X\""), p6::Trace::get_event_count());
+	EXPECT_EQ(json.back(), '\n');
+
+	//Cleared trace keeps recording into buffers of the same threads
+	p6::Trace::clear();
+	EXPECT_EQ(p6::Trace::get_event_count(), 0);
+	p6::Trace::enable(true);
+	{ p6::TraceScope trace("event"); }
+	p6::Trace::enable(false);
+	EXPECT_EQ(p6::Trace::get_event_count(), 1);
+	p6::Trace::clear();
+}
+
+//Stability
+TEST(Stability, StableBridge)
+{
+	p6::Construction con;
+	create_bridge(&con, 10, true);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Stability stability(&snapshot);
+	EXPECT_TRUE(stability.stable());
+	EXPECT_EQ(stability.get_node_count(), 0);
+}
+
+TEST(Stability, LargeBridge)
+{
+	p6::Construction con;
+	create_bridge(&con, 1000, true);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Stability stability(&snapshot);
+	EXPECT_TRUE(stability.stable());
+
+	p6::uint hinge = con.create_node();
+	con.set_node_coord(hinge, p6::Coord(0.5, 0.0));
+	con.set_node_freedom(hinge, 2);
+	p6::uint node[2] = { 0, hinge };
+	con.set_stick_material(con.create_stick(node), 0);
+	node[0] = 1;
+	con.set_stick_material(con.create_stick(node), 0);
+	snapshot = con.snapshot();
+	p6::Stability degenerate(&snapshot);
+	EXPECT_TRUE(degenerate.combinatorial());
+	EXPECT_FALSE(degenerate.geometric());
+	ASSERT_EQ(degenerate.get_node_count(), 1);
+	EXPECT_EQ(degenerate.get_node(0), hinge);
+}
+
+TEST(Stability, MissingDiagonal)
+{
+	p6::Construction con;
+	create_bridge(&con, 6, true);
+	con.delete_stick(con.get_stick_count() - 1);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Stability stability(&snapshot);
+	EXPECT_FALSE(stability.combinatorial());
+	EXPECT_EQ(stability.get_degrees(), 1);
+	EXPECT_GT(stability.get_node_count(), 0);
+	EXPECT_ANY_THROW(con.simulate(true));
+}
+
+TEST(Stability, MissingSupport)
+{
+	p6::Construction con;
+	create_bridge(&con, 4, true);
+	con.set_node_freedom(4, 2);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Stability stability(&snapshot);
+	EXPECT_FALSE(stability.stable());
+	EXPECT_EQ(stability.get_node_count(), 7);
+}
+
+TEST(Stability, VerticalRail)
+{
+	//Vertical rail lets bridge turn around left support
+	p6::Construction con;
+	create_inclined_bridge(&con, 8, 2.0 * atan(1.0));
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Stability stability(&snapshot);
+	EXPECT_TRUE(stability.combinatorial());
+	EXPECT_FALSE(stability.geometric());
+	EXPECT_ANY_THROW(snapshot.solve());
+}
+
+TEST(Stability, CollinearSticks)
+{
+	p6::Construction con;
+	con.create_linear_material("steel", 100.0);
+	for (p6::uint i = 0; i < 3; i++)
+	{
+		con.create_node();
+		con.set_node_coord(i, p6::Coord((p6::real)i, 0.0));
+	}
+	con.set_node_freedom(1, 2);
+	for (p6::uint i = 0; i < 2; i++)
+	{
+		p6::uint node[2] = { i, i + 1 };
+		con.create_stick(node);
+		con.set_stick_material(i, 0);
+		con.set_stick_area(i, 1.0);
+	}
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Stability stability(&snapshot);
+	EXPECT_TRUE(stability.combinatorial());
+	EXPECT_FALSE(stability.geometric());
+	ASSERT_EQ(stability.get_node_count(), 1);
+	EXPECT_EQ(stability.get_node(0), 1);
+}
+
+TEST(Stability, LoadedCollinearSticks)
+{
+	//String between fixed nodes sags under load until it carries it
+	p6::Construction con;
+	con.create_linear_material("steel", 100.0);
+	for (p6::uint i = 0; i < 3; i++)
+	{
+		con.create_node();
+		con.set_node_coord(i, p6::Coord((p6::real)i, 0.0));
+	}
+	con.set_node_freedom(1, 2);
+	for (p6::uint i = 0; i < 2; i++)
+	{
+		p6::uint node[2] = { i, i + 1 };
+		con.create_stick(node);
+		con.set_stick_material(i, 0);
+		con.set_stick_area(i, 1.0);
+	}
+	p6::uint force = con.create_force(1);
+	con.set_force_direction(force, p6::Coord(0.0, -1.0));
+	std::ostringstream log;
+	con.set_log(&log);
+	ASSERT_NO_THROW(con.simulate(true));
+	EXPECT_NEAR(con.get_node_coord(1).x, 1.0, 1e-10);
+	EXPECT_LT(con.get_node_coord(1).y, -0.1);
+	EXPECT_NE(log.str().find("initial position"), std::string::npos);
+
+	//Sticks carry the load in equilibrium
+	p6::real sine = -con.get_node_coord(1).y / (con.get_node_coord(1) - con.get_node_coord(0)).norm();
+	EXPECT_NEAR(2.0 * con.get_stick_force(0) * sine, 1.0, 1e-4);
+}
+
+//Block sparse matrix
+TEST(BlockSparseMatrix, MatchesDense)
+{
+	//Chain of three 2x2 blocks and one 1x1 block, with nonsymmetric values
+	p6::BlockSparseMatrix sparse;
+	sparse.create({ 2, 2, 2, 1 }, { 0, 1, 1, 2, 2, 3, 3, 0 });
+	EXPECT_EQ(sparse.get_size(), 7);
+	EXPECT_EQ(sparse.get_stored_block_count(), 12);
+	p6::Matrix dense;
+	sparse.to_dense(&dense);
+	for (p6::uint i = 0; i < 7; i++)
+	{
+		for (p6::uint j = 0; j < 7; j++)
+		{
+			bool stored = (i / 2 == j / 2) || (i / 2 + 1 == j / 2) || (j / 2 + 1 == i / 2) || ((i / 2 == 3) != (j / 2 == 3) && (i < 2 || j < 2));
+			if (stored) sparse.at(i, j) = (i == j) ? 10.0 : 1.0 + 0.1 * i - 0.2 * j;
+		}
+	}
+	sparse.to_dense(&dense);
+
+	p6::Vector x(7), y, expected;
+	for (p6::uint i = 0; i < 7; i++) x(i) = 1.0 + i;
+	sparse.multiply(&x, &y);
+	expected = dense * x;
+	EXPECT_NEAR((y - expected).norm(), 0.0, 1e-12);
+
+	ASSERT_TRUE(sparse.factorize());
+	p6::Vector solution;
+	sparse.solve(&x, &solution);
+	EXPECT_NEAR((dense * solution - x).norm(), 0.0, 1e-12);
+
+	//Single precision factorization reaches double precision with refinement
+	ASSERT_TRUE(sparse.factorize(true));
+	sparse.solve(&x, &solution);
+	EXPECT_GT((dense * solution - x).norm(), 1e-12);
+	ASSERT_TRUE(sparse.refine(&x, &solution));
+	EXPECT_NEAR((dense * solution - x).norm(), 0.0, 1e-12);
+}
+
+TEST(BlockSparseMatrix, PartialRefactorization)
+{
+	//Chain of six 2x2 blocks
+	p6::BlockSparseMatrix sparse;
+	sparse.create({ 2, 2, 2, 2, 2, 2 }, { 0, 1, 1, 2, 2, 3, 3, 4, 4, 5 });
+	for (p6::uint i = 0; i < 12; i++)
+	{
+		for (p6::uint j = 0; j < 12; j++)
+		{
+			if (i / 2 == j / 2 || i / 2 + 1 == j / 2 || j / 2 + 1 == i / 2) sparse.at(i, j) = (i == j) ? 10.0 : 1.0 + 0.1 * i - 0.2 * j;
+		}
+	}
+	ASSERT_TRUE(sparse.factorize());
+	EXPECT_EQ(sparse.get_factorization_start(), 0);
+	ASSERT_TRUE(sparse.factorize());
+	EXPECT_EQ(sparse.get_factorization_start(), 12);
+
+	//Changing any block gives the same solution as full factorization, some changes keep leading factors
+	p6::uint max_start = 0;
+	p6::Vector x(12), solution;
+	for (p6::uint i = 0; i < 12; i++) x(i) = 1.0 + i;
+	for (p6::uint block = 0; block < 6; block++)
+	{
+		sparse.at(2 * block, 2 * block) += 1.0;
+		ASSERT_TRUE(sparse.factorize());
+		max_start = std::max(max_start, sparse.get_factorization_start());
+		sparse.solve(&x, &solution);
+		p6::Matrix dense;
+		sparse.to_dense(&dense);
+		EXPECT_NEAR((dense * solution - x).norm(), 0.0, 1e-12);
+	}
+	EXPECT_GT(max_start, 0);
+}
+
+//Domain decomposition
+TEST(DomainDecomposition, MatchesDirect)
+{
+	p6::Construction con;
+	create_bridge(&con, 40, true);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Vector s, b(snapshot.get_variable_number()), expected, x;
+	p6::BlockSparseMatrix d;
+	snapshot.get_initial_state(&s);
+	snapshot.get_tangent(&s, &d);
+	for (p6::uint i = 0; i < (p6::uint)b.size(); i++) b(i) = sin(1.0 + i);
+
+	//Long bridge is cut across, so boundary is a few nodes per cut
+	p6::DomainDecomposition domains;
+	domains.create(&d, 4, 2);
+	EXPECT_EQ(domains.get_subdomain_count(), 4);
+	EXPECT_LT(domains.get_boundary_size(), d.get_size() / 4);
+	p6::uint interior = domains.get_boundary_size();
+	for (p6::uint i = 0; i < domains.get_subdomain_count(); i++) interior += domains.get_interior_size(i);
+	EXPECT_EQ(interior, d.get_size());
+	ASSERT_TRUE(domains.factorize(&d));
+	domains.solve(&b, &x);
+	ASSERT_TRUE(d.factorize());
+	d.solve(&b, &expected);
+	EXPECT_LT((x - expected).norm(), 1e-9 * expected.norm());
+
+	//Simulation reaches the same equilibrium, loads are reduced so that long bridge converges from initial state
+	for (p6::uint i = 0; i < con.get_force_count(); i++) con.set_force_direction(i, p6::Coord(0.0, -0.01));
+	snapshot = con.snapshot();
+	p6::Snapshot::Options options;
+	p6::Solution direct = snapshot.solve(&options);
+	options.method = p6::Snapshot::Method::decomposition;
+	options.subdomains = 3;
+	options.threads = 2;
+	p6::Solution decomposed = snapshot.solve(&options);
+	for (p6::uint i = 0; i < direct.get_node_count(); i++)
+	{
+		EXPECT_NEAR(decomposed.get_node_coord(i).x, direct.get_node_coord(i).x, 1e-6);
+		EXPECT_NEAR(decomposed.get_node_coord(i).y, direct.get_node_coord(i).y, 1e-6);
+	}
+}
+
+//Linear analysis
+TEST(LinearAnalysis, RankOneUpdates)
+{
+	p6::Construction original, edited;
+	create_bridge(&original, 8, true);
+	create_bridge(&edited, 8, true);
+	edited.create_linear_material("aluminium", 70000.0);
+	edited.set_stick_area(3, 2.0);
+	edited.set_stick_material(5, 1);
+	p6::Snapshot original_snapshot = original.snapshot(), edited_snapshot = edited.snapshot();
+
+	//Small displacements match nonlinear simulation
+	p6::LinearAnalysis analysis(&original_snapshot);
+	ASSERT_TRUE(analysis.stable());
+	p6::Solution solution = original_snapshot.solve();
+	EXPECT_NEAR(analysis.get_node_displacement(4).y, solution.get_node_coord(4).y, 1e-3 * abs(solution.get_node_coord(4).y));
+
+	//Updated factorization matches factorization of edited construction
+	analysis.set_stick_area(3, 2.0);
+	analysis.set_stick_material(5, edited_snapshot.get_stick_material(5));
+	EXPECT_EQ(analysis.get_update_count(), 2);
+	EXPECT_EQ(analysis.get_factorization_count(), 1);
+	p6::LinearAnalysis expected(&edited_snapshot);
+	for (p6::uint i = 0; i < edited.get_node_count(); i++)
+	{
+		EXPECT_NEAR(analysis.get_node_displacement(i).x, expected.get_node_displacement(i).x, 1e-12);
+		EXPECT_NEAR(analysis.get_node_displacement(i).y, expected.get_node_displacement(i).y, 1e-12);
+	}
+	for (p6::uint i = 0; i < edited.get_stick_count(); i++) EXPECT_NEAR(analysis.get_stick_force(i), expected.get_stick_force(i), 1e-10);
+
+	//Downdate restores original
+	analysis.set_stick_area(3, 1.0);
+	p6::LinearAnalysis restored(&original_snapshot);
+	EXPECT_EQ(analysis.get_update_count(), 3);
+	EXPECT_NEAR(analysis.get_stick_force(3), restored.get_stick_force(3), 1e-10);
+}
+
+TEST(LinearAnalysis, RedundancyScan)
+{
+	//Second diagonal in second panel makes its sticks redundant
+	p6::Construction con;
+	create_bridge(&con, 8, true);
+	p6::uint node[2] = { 1, 10 };
+	p6::uint brace = con.create_stick(node);
+	con.set_stick_material(brace, 0);
+	con.set_stick_area(brace, 1.0);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::LinearAnalysis analysis(&snapshot);
+	std::vector<p6::LinearAnalysis::Removal> removal, single;
+	analysis.scan_redundancy(5.0, 4, &removal);
+	analysis.scan_redundancy(5.0, 1, &single);
+
+	p6::uint redundant = 0;
+	for (p6::uint i = 0; i < con.get_stick_count(); i++)
+	{
+		EXPECT_EQ(removal[i].mechanism, single[i].mechanism);
+		if (removal[i].mechanism) continue;
+		redundant++;
+		EXPECT_EQ(removal[i].max_stress, single[i].max_stress);
+
+		//Matches analysis of construction without stick
+		p6::LinearAnalysis reduced(&snapshot);
+		reduced.set_stick_area(i, 0.0);
+		ASSERT_TRUE(reduced.stable());
+		p6::real max_stress = 0.0;
+		for (p6::uint j = 0; j < con.get_stick_count(); j++)
+		{
+			if (j != i) max_stress = std::max(max_stress, abs(reduced.get_stick_force(j)));
+		}
+		EXPECT_NEAR(removal[i].max_stress, max_stress, 1e-9 * max_stress);
+		EXPECT_EQ(removal[i].overstressed, max_stress > 5.0);
+	}
+	EXPECT_EQ(redundant, 6);
+}
+
+TEST(LinearAnalysis, InfluenceLines)
+{
+	p6::Construction con;
+	create_bridge(&con, 6, true);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::LinearAnalysis analysis(&snapshot);
+	std::vector<p6::uint> deck;
+	for (p6::uint i = 0; i <= 6; i++) deck.push_back(i);
+	p6::Matrix force;
+	analysis.get_influence_lines(&deck, p6::Coord(0.0, -1.0), &force);
+	ASSERT_EQ(force.rows(), con.get_stick_count());
+	ASSERT_EQ(force.cols(), deck.size());
+
+	//Each column matches analysis with single load, load on support gives no forces
+	for (p6::uint j = 1; j < 6; j++)
+	{
+		p6::Construction single;
+		create_bridge(&single, 6, true);
+		for (p6::uint i = 0; i < 5; i++) single.delete_force(single.get_force_count() - 1);
+		p6::uint f = single.create_force(j);
+		single.set_force_direction(f, p6::Coord(0.0, -1.0));
+		p6::Snapshot single_snapshot = single.snapshot();
+		p6::LinearAnalysis expected(&single_snapshot);
+		for (p6::uint i = 0; i < con.get_stick_count(); i++) EXPECT_NEAR(force(i, j), expected.get_stick_force(i), 1e-10);
+	}
+	for (p6::uint i = 0; i < con.get_stick_count(); i++) EXPECT_NEAR(force(i, 0), 0.0, 1e-10);
+
+	//Envelope contains forces under existing loads
+	std::vector<p6::real> min, max;
+	analysis.get_force_envelope(&deck, p6::Coord(0.0, -1.0), &min, &max);
+	for (p6::uint i = 0; i < con.get_stick_count(); i++)
+	{
+		p6::real base = analysis.get_stick_force(i);
+		EXPECT_NEAR(min[i], base + std::min(0.0, force.row(i).minCoeff()), 1e-10);
+		EXPECT_NEAR(max[i], base + std::max(0.0, force.row(i).maxCoeff()), 1e-10);
+	}
+}
+
+//Symmetry
+TEST(Symmetry, SymmetricBridge)
+{
+	p6::Construction con;
+	create_bridge(&con, 6, false);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Symmetry symmetry(&snapshot);
+	ASSERT_TRUE(symmetry.symmetric());
+	EXPECT_NEAR(symmetry.get_axis(), 3.0, 1e-12);
+	EXPECT_EQ(symmetry.get_mirror(1), 5);
+	EXPECT_EQ(symmetry.get_mirror(3), 3);
+	EXPECT_EQ(symmetry.get_mirror(7), 11);
+	//Bottom chord nodes have 2 variables per pair and 1 on axis, so do top chord nodes
+	EXPECT_EQ(symmetry.get_variable_number(), 10);
+
+	//Half model gives symmetric result
+	con.simulate(true);
+	EXPECT_LT(con.get_node_coord(3).y, 0.0);
+	EXPECT_NEAR(con.get_node_coord(3).x, 3.0, 1e-12);
+	EXPECT_NEAR(con.get_node_coord(1).y, con.get_node_coord(5).y, 1e-12);
+	EXPECT_NEAR(con.get_node_coord(1).x + con.get_node_coord(5).x, 6.0, 1e-12);
+}
+
+TEST(Symmetry, LargeBridge)
+{
+	p6::Construction con;
+	create_bridge(&con, 300, false);
+	for (p6::uint i = 0; i < con.get_force_count(); i++) con.set_force_direction(i, p6::Coord(0.0, -0.000001));
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Snapshot::Options full_options, half_options;
+	full_options.symmetry = false;
+	half_options.symmetry = true;
+
+	//Half model has half of variables and it's sparse factorization is cheaper than factorization of full model
+	p6::Symmetry symmetry(&snapshot);
+	ASSERT_TRUE(symmetry.symmetric());
+	EXPECT_LE(2 * symmetry.get_variable_number(), snapshot.get_variable_number());
+	p6::BlockSparseMatrix d, reduced;
+	std::vector<p6::uint> scatter;
+	snapshot.create_tangent(&d, &scatter);
+	symmetry.create_reduced_matrix(&d, &reduced);
+	EXPECT_LT(reduced.get_envelope_size(), d.get_envelope_size() / 2);
+	EXPECT_LT(reduced.get_factorization_cost(), d.get_factorization_cost() / 2);
+
+	//Both models reach the same equilibrium
+	p6::Solution full = snapshot.solve(&full_options);
+	p6::Solution half = snapshot.solve(&half_options);
+	for (p6::uint i = 0; i < full.get_node_count(); i++)
+	{
+		EXPECT_NEAR(half.get_node_coord(i).x, full.get_node_coord(i).x, 1e-6);
+		EXPECT_NEAR(half.get_node_coord(i).y, full.get_node_coord(i).y, 1e-6);
+	}
+}
+
+TEST(Symmetry, AsymmetricSupport)
+{
+	p6::Construction con;
+	create_bridge(&con, 6, true);
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Symmetry symmetry(&snapshot);
+	EXPECT_FALSE(symmetry.symmetric());
+}
+
+TEST(Symmetry, AsymmetricLoad)
+{
+	p6::Construction con;
+	create_bridge(&con, 6, false);
+	con.set_force_direction(0, p6::Coord(0.0, -2.0));
+	p6::Snapshot snapshot = con.snapshot();
+	p6::Symmetry symmetry(&snapshot);
+	EXPECT_FALSE(symmetry.symmetric());
+}
+
+//Superelement
+TEST(Superelement, MatchesPlainImport)
+{
+	TemporaryFile part_file("superelement_part.p6");
+	TemporaryFile host_file("superelement_host.p6");
+	p6::Construction part;
+	create_bridge(&part, 4, false);
+	part.save(part_file.path());
+
+	//Bridge condensed to it's supports, placed on supports of which right is on rail
+	p6::Construction condensed;
+	p6::uint superelement = condensed.import_superelement(part_file.path(), p6::Construction::Condensation::tangent);
+	ASSERT_EQ(condensed.get_superelement_node_count(superelement), 2);
+	p6::uint left = condensed.get_superelement_node(superelement, 0);
+	p6::uint right = condensed.get_superelement_node(superelement, 1);
+	condensed.set_node_freedom(left, 0);
+	condensed.set_node_freedom(right, 1);
+	condensed.set_node_rail_angle(right, 0.0);
+	condensed.simulate(true);
+	p6::Coord coord = condensed.get_node_coord(right);
+	condensed.simulate(false);
+
+	//Same bridge imported stick by stick
+	p6::Construction plain;
+	plain.import(part_file.path());
+	plain.set_node_freedom(4, 1);
+	plain.set_node_rail_angle(4, 0.0);
+	plain.simulate(true);
+	EXPECT_GT(plain.get_node_coord(4).x - 4.0, 1e-6);
+	EXPECT_NEAR(coord.x, plain.get_node_coord(4).x, 1e-7);
+	EXPECT_NEAR(coord.y, 0.0, 1e-12);
+	plain.simulate(false);
+
+	//Superelements survive saving
+	condensed.save(host_file.path());
+	p6::Construction loaded;
+	loaded.load(host_file.path());
+	ASSERT_EQ(loaded.get_superelement_count(), 1);
+	loaded.simulate(true);
+	EXPECT_NEAR(loaded.get_node_coord(right).x, coord.x, 1e-12);
+	loaded.simulate(false);
+
+}
+
+TEST(Superelement, LoadSteps)
+{
+	TemporaryFile part_file("superelement_part.p6");
+	p6::Construction part;
+	create_bridge(&part, 4, false);
+	part.save(part_file.path());
+	p6::Construction con;
+	p6::uint superelement = con.import_superelement(part_file.path(), p6::Construction::Condensation::tangent);
+	p6::uint right = con.get_superelement_node(superelement, 1);
+	con.set_node_freedom(con.get_superelement_node(superelement, 0), 0);
+	con.set_node_freedom(right, 1);
+	con.set_node_rail_angle(right, 0.0);
+
+	//Condensed loads are applied in steps like other loads
+	p6::Snapshot snapshot = con.snapshot();
+	RecordingObserver single, stepped;
+	p6::Snapshot::Options options;
+	options.method = p6::Snapshot::Method::direct;
+	options.observer = &single;
+	p6::Solution solution = snapshot.solve(&options);
+	options.observer = &stepped;
+	options.load_steps = 2;
+	EXPECT_NEAR(snapshot.solve(&options).get_node_coord(right).x, solution.get_node_coord(right).x, 1e-10);
+	ASSERT_FALSE(single.iteration.empty());
+	ASSERT_FALSE(stepped.iteration.empty());
+	EXPECT_NEAR(stepped.iteration.front().residual, single.iteration.front().residual / 2.0, 1e-12 * single.iteration.front().residual);
+}
+
+TEST(Superelement, AsymmetricLoad)
+{
+	TemporaryFile part_file("superelement_part.p6");
+
+	//Part loaded on one side only is condensed to it's supports
+	save_superelement_part(part_file.path(), 6, true);
+	p6::Construction condensed;
+	p6::uint superelement = condensed.import_superelement(part_file.path(), p6::Construction::Condensation::tangent);
+	p6::uint left = condensed.get_superelement_node(superelement, 0);
+	p6::uint right = condensed.get_superelement_node(superelement, 1);
+	condensed.set_node_freedom(left, 0);
+	condensed.set_node_freedom(right, 1);
+	condensed.set_node_rail_angle(right, 0.0);
+	p6::Snapshot snapshot = condensed.snapshot();
+	EXPECT_FALSE(p6::Symmetry(&snapshot).symmetric());
+	p6::Snapshot::Options options;
+	options.load_steps = 3;
+	p6::Solution solution = snapshot.solve(&options);
+
+	//Same part imported stick by stick
+	p6::Construction plain;
+	plain.import(part_file.path());
+	plain.set_node_freedom(6, 1);
+	plain.set_node_rail_angle(6, 0.0);
+	plain.simulate(true);
+	EXPECT_GT(plain.get_node_coord(6).x - 6.0, 1e-6);
+	EXPECT_NEAR(solution.get_node_coord(right).x, plain.get_node_coord(6).x, 1e-7);
+}
+
+TEST(Superelement, DamagedFile)
+{
+	TemporaryFile part_file("superelement_part.p6");
+	TemporaryFile host_file("superelement_host.p6");
+	TemporaryFile damaged_file("superelement_damaged.p6");
+	save_superelement_part(part_file.path(), 4, false);
+	p6::Construction host;
+	host.import_superelement(part_file.path(), p6::Construction::Condensation::tangent);
+	host.save(host_file.path());
+	std::ifstream input(host_file.path(), std::ios::binary);
+	std::ostringstream stream;
+	stream << input.rdbuf();
+	input.close();
+	const std::string content = stream.str();
+	p6::Construction loaded;
+	ASSERT_NO_THROW(loaded.load(host_file.path()));
+
+	//File ends with superelement's nodes, preceded by it's block index, number of superelements and block of two nodes
+	const size_t superelement_size = 4 * sizeof(p6::uint);
+	const size_t block_size = 2 * sizeof(p6::Coord) + 16 * sizeof(p6::real) + 4 * sizeof(p6::real);
+	auto damaged = [&content, &damaged_file](size_t offset, p6::uint value)
+	{
+		std::string copy = content;
+		memcpy(&copy[offset], &value, sizeof(p6::uint));
+		std::ofstream output(damaged_file.path(), std::ios::binary);
+		output.write(copy.data(), copy.size());
+	};
+
+	//Huge number of boundary nodes is rejected before allocation
+	damaged(content.size() - superelement_size - block_size - sizeof(p6::uint), (p6::uint)1 << 40);
+	EXPECT_THROW(loaded.load(damaged_file.path()), std::runtime_error);
+
+	//Node outside of construction is rejected
+	damaged(content.size() - sizeof(p6::uint), 1000);
+	EXPECT_THROW(loaded.load(damaged_file.path()), std::runtime_error);
+
+	//Truncated file is rejected
+	copy_truncated(host_file.path(), damaged_file.path(), 1);
+	EXPECT_THROW(loaded.load(damaged_file.path()), std::runtime_error);
+	p6::Construction imported;
+	EXPECT_THROW(imported.import(damaged_file.path()), std::runtime_error);
+	EXPECT_EQ(imported.get_superelement_count(), 0);
+
+}
+
+TEST(Superelement, ChangedPart)
+{
+	TemporaryFile part_file("superelement_part.p6");
+	TemporaryFile host_file("superelement_host.p6");
+
+	//Host is saved with block of short part
+	save_superelement_part(part_file.path(), 4, false);
+	p6::Construction host;
+	p6::uint superelement = host.import_superelement(part_file.path(), p6::Construction::Condensation::tangent);
+	p6::uint right = host.get_superelement_node(superelement, 1);
+	host.set_node_freedom(host.get_superelement_node(superelement, 0), 0);
+	host.set_node_freedom(right, 1);
+	host.set_node_rail_angle(right, 0.0);
+	host.save(host_file.path());
+	host.simulate(true);
+
+	//Part file changes after another construction cached it's block
+	save_superelement_part(part_file.path(), 6, false);
+	p6::Construction con;
+	con.import_superelement(part_file.path(), p6::Construction::Condensation::tangent);
+	con.delete_node(1);
+	con.delete_node(0);
+	ASSERT_EQ(con.get_superelement_count(), 0);
+
+	//Block saved in host file is used, not the cached one
+	con.import(host_file.path());
+	ASSERT_EQ(con.get_superelement_count(), 1);
+	con.simulate(true);
+	p6::uint imported = con.get_superelement_node(0, 1);
+	EXPECT_NEAR(con.get_node_coord(imported).x, host.get_node_coord(right).x, 1e-12);
+	EXPECT_NEAR(con.get_node_coord(imported).y, host.get_node_coord(right).y, 1e-12);
+
+}
+
+TEST(Superelement, DeletedWithNode)
+{
+	TemporaryFile part_file("superelement_part.p6");
+	p6::Construction part;
+	create_bridge(&part, 4, false);
+	part.save(part_file.path());
+	p6::Construction con;
+	con.import_superelement(part_file.path(), p6::Construction::Condensation::linear);
+	con.delete_node(0);
+	EXPECT_EQ(con.get_superelement_count(), 0);
+}
+
 int main(int argc, char **argv)
 {
 	::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,151 @@
+/*
+	This software is distributed under MIT License, which means:
+		- Do whatever you want
+		- Please keep this notice and include the license file to your project
+		- I provide no warranty
+
+	Created by Kyrylo Sovailo (github.com/Meta-chan, k.sovailo@gmail.com)
+	Reinventing bicycles since 2020
+*/
+
+
+#include "../header/p6_trace.hpp"
+#include "../header/p6_file.hpp"
+#include <stdexcept>
+#include <new>
+
+std::atomic<bool> p6::Trace::_enabled(false);
+std::chrono::steady_clock::time_point p6::Trace::_start = std::chrono::steady_clock::now();
+std::mutex p6::Trace::_mutex;
+std::vector<p6::Trace::Buffer*> p6::Trace::_buffer;
+
+p6::Trace::Block::Block() noexcept : count(0), next(nullptr)
+{}
+
+p6::Trace::Buffer *p6::Trace::_get_buffer() noexcept
+{
+	thread_local Buffer *buffer = nullptr;
+	if (buffer != nullptr) return buffer;
+	try
+	{
+		Buffer *created = new Buffer;
+		created->first = created->last = new Block;
+		std::lock_guard<std::mutex> lock(_mutex);
+		created->thread = _buffer.size() + 1;
+		_buffer.push_back(created);
+		buffer = created;
+	}
+	catch (std::bad_alloc&) {}
+	return buffer;
+}
+
+void p6::Trace::enable(bool enable) noexcept
+{
+	_enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool p6::Trace::enabled() noexcept
+{
+	return _enabled.load(std::memory_order_relaxed);
+}
+
+void p6::Trace::record(const char *name, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) noexcept
+{
+	Buffer *buffer = _get_buffer();
+	if (buffer == nullptr) return;
+	Block *block = buffer->last;
+	uint count = block->count.load(std::memory_order_relaxed);
+	if (count == Block::capacity)
+	{
+		Block *next = new (std::nothrow) Block;
+		if (next == nullptr) return;
+		block->next.store(next, std::memory_order_release);
+		block = buffer->last = next;
+		count = 0;
+	}
+
+	//Event becomes visible to thread writing trace only after it is complete
+	Event *event = &block->event[count];
+	event->name = name;
+	event->begin = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - _start).count();
+	event->duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+	block->count.store(count + 1, std::memory_order_release);
+}
+
+p6::uint p6::Trace::get_event_count()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	uint count = 0;
+	for (uint i = 0; i < _buffer.size(); i++)
+	{
+		for (const Block *block = _buffer[i]->first; block != nullptr; block = block->next.load(std::memory_order_acquire))
+			count += block->count.load(std::memory_order_acquire);
+	}
+	return count;
+}
+
+void p6::Trace::clear()
+{
+	//First block of every buffer is kept empty, so owning thread continues filling it
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (uint i = 0; i < _buffer.size(); i++)
+	{
+		Block *block = _buffer[i]->first->next.load(std::memory_order_acquire);
+		while (block != nullptr)
+		{
+			Block *next = block->next.load(std::memory_order_acquire);
+			delete block;
+			block = next;
+		}
+		_buffer[i]->first->next.store(nullptr, std::memory_order_release);
+		_buffer[i]->first->count.store(0, std::memory_order_release);
+		_buffer[i]->last = _buffer[i]->first;
+	}
+}
+
+void p6::Trace::write(const String filepath)
+{
+	//Complete events ("ph":"X") with microsecond timestamps, one track per thread
+	String json = "{\"traceEvents\":[";
+	bool first = true;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (uint i = 0; i < _buffer.size(); i++)
+		{
+			for (const Block *block = _buffer[i]->first; block != nullptr; block = block->next.load(std::memory_order_acquire))
+			{
+				uint count = block->count.load(std::memory_order_acquire);
+				for (uint j = 0; j < count; j++)
+				{
+					const Event *event = &block->event[j];
+					if (!first) json += ",";
+					first = false;
+					json += "\n{\"name\":\"";
+					for (const char *c = event->name; *c != '\0'; c++)
+					{
+						if (*c == '"' || *c == '\\') json += '\\';
+						json += *c;
+					}
+					json += "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(_buffer[i]->thread);
+					json += ",\"ts\":" + std::to_string(event->begin / 1000) + "." + std::to_string(event->begin / 100 % 10);
+					json += ",\"dur\":" + std::to_string(event->duration / 1000) + "." + std::to_string(event->duration / 100 % 10) + "}";
+				}
+			}
+		}
+	}
+	json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	OutputFile file(filepath);
+	if (!file.ok()) throw std::runtime_error("File cannot be opened for write");
+	file.write(json.data(), json.size());
+}
+
+p6::TraceScope::TraceScope(const char *name) noexcept : _name(name), _enabled(Trace::enabled())
+{
+	if (_enabled) _begin = std::chrono::steady_clock::now();
+}
+
+p6::TraceScope::~TraceScope() noexcept
+{
+	if (_enabled) Trace::record(_name, _begin, std::chrono::steady_clock::now());
+}